@@ -36,6 +36,7 @@
 #include "job.h"
 #include "option.h"
 #include "path.h"
+#include "profile.h"
 #include "sig.h"
 #include "strbuf.h"
 #include "util.h"
@@ -164,7 +165,7 @@ void init_builtin(void)
     DEFBUILTIN("bg", fg_builtin, BI_MANDATORY, bg_help, bg_syntax,
             help_option);
     DEFBUILTIN("wait", wait_builtin, BI_MANDATORY, wait_help, wait_syntax,
-            help_option);
+            wait_options);
     DEFBUILTIN("disown", disown_builtin, BI_ELECTIVE, disown_help,
             disown_syntax, all_help_options);
 
@@ -192,9 +193,15 @@ void init_builtin(void)
             command_syntax, command_options);
     DEFBUILTIN("type", command_builtin, BI_MANDATORY, type_help, type_syntax,
             command_options);
+    DEFBUILTIN("coproc", coproc_builtin, BI_EXTENSION, coproc_help,
+            coproc_syntax, coproc_options);
     DEFBUILTIN("times", times_builtin, BI_SPECIAL, times_help, times_syntax,
             help_option);
 
+    /* defined in "profile.c" */
+    DEFBUILTIN("profile", profile_builtin, BI_EXTENSION, profile_help,
+            profile_syntax, profile_options);
+
     /* defined in "yash.c" */
     DEFBUILTIN("exit", exit_builtin, BI_SPECIAL, exit_help, exit_syntax,
             force_help_options);
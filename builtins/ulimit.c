@@ -33,6 +33,7 @@
 #include <wctype.h>
 #include "../builtin.h"
 #include "../exec.h"
+#include "../redir.h"
 #include "../util.h"
 /* Including <stdint.h> is required before including <sys/resource.h> on
  * FreeBSD, but <stdint.h> is automatically included in <inttypes.h>. */
@@ -223,6 +224,10 @@ int ulimit_builtin(int argc, void **argv)
         return Exit_FAILURE;
     }
 
+    /* shell FDs must be below the new limit on open files */
+    if (resource->type == RLIMIT_NOFILE)
+        reset_shellfdmin();
+
     return Exit_SUCCESS;
 
 err_format:
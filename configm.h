@@ -0,0 +1,10 @@
+/* configm.h: created by Makefile */
+#ifndef YASH_CONFIGM_H
+#define YASH_CONFIGM_H
+#define PACKAGE_NAME "yash"
+#define PACKAGE_VERSION "2.57"
+#define PACKAGE_COPYRIGHT "Copyright (C) 2007-2024 magicant"
+#define YASH_DATADIR "/usr/local/share/yash"
+#define LOCALEDIR "/usr/local/share/locale"
+#define DEFAULT_LOADPATH "/usr/local/share/yash"
+#endif
@@ -35,6 +35,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/times.h>
 #include <unistd.h>
 #include <wchar.h>
@@ -50,6 +51,7 @@
 #include "parser.h"
 #include "path.h"
 #include "plist.h"
+#include "profile.h"
 #include "redir.h"
 #include "sig.h"
 #include "strbuf.h"
@@ -137,12 +139,22 @@ typedef struct execstate_T {
     bool iterating;         /* true when iterative execution is ongoing */
 } execstate_T;
 
+/* An iteration of a parallel for loop. */
+typedef struct paralleliter_T {
+    size_t jobnumber;  /* job number of the subshell, or 0 if not running */
+    int outfd;         /* temporary file buffering the output, or -1 */
+    bool done;         /* true if the subshell has finished */
+    int status;        /* exit status of the finished subshell */
+} paralleliter_T;
+
 static void exec_pipelines(const pipeline_T *p, bool finally_exit);
 static void exec_pipelines_async(const pipeline_T *p)
     __attribute__((nonnull));
 
 static void exec_commands(command_T *cs, exec_T type)
     __attribute__((nonnull));
+static void log_pipeline_rusage(const command_T *cs, const job_T *job)
+    __attribute__((nonnull));
 static inline size_t number_of_commands_in_pipeline(const command_T *c)
     __attribute__((nonnull,pure,warn_unused_result));
 static void apply_errexit_errreturn(const command_T *c);
@@ -167,12 +179,15 @@ static bool exec_simple_command_with_words(
         const command_T *c, int argc, void **argv, bool finally_exit)
     __attribute__((nonnull,warn_unused_result));
 static void print_xtrace(void *const *argv);
+static void buffer_xtrace(void *const *argv, bool tracevars);
 static void search_command(
         const char *restrict name, const wchar_t *restrict wname,
         commandinfo_T *restrict ci, enum srchcmdtype_T type)
     __attribute__((nonnull));
 static inline bool is_special_builtin(const char *cmdname)
     __attribute__((nonnull,pure));
+static inline bool is_read_builtin(const commandinfo_T *ci)
+    __attribute__((nonnull,pure));
 static bool command_not_found_handler(void *const *argv)
     __attribute__((nonnull));
 static wchar_t **invoke_simple_command(const commandinfo_T *ci,
@@ -198,6 +213,13 @@ static void exec_if(const command_T *c, bool finally_exit)
 static inline bool exec_condition(const and_or_T *c);
 static void exec_for(const command_T *c, bool finally_exit)
     __attribute__((nonnull));
+static void exec_for_parallel(const command_T *c, int count, void **words)
+    __attribute__((nonnull));
+static int open_parallel_output(void);
+static void copy_parallel_output(int fd);
+static size_t start_parallel_iteration(const command_T *c, const wchar_t *word,
+        int outfd, int breakfd)
+    __attribute__((nonnull));
 static void exec_while(const command_T *c, bool finally_exit)
     __attribute__((nonnull));
 static void exec_case(const command_T *c, bool finally_exit)
@@ -254,6 +276,17 @@ static const assign_T *last_assign;
  * trimmed when the buffer is flushed to the standard error. */
 static xwcsbuf_T xtrace_buffer = { .contents = NULL };
 
+/* The file descriptor to which traces are written, or -1 if traces are printed
+ * to the standard error. Set from the value of $YASH_XTRACEFD.
+ * Traces written to this file descriptor are accumulated in `xtrace_output'
+ * and written out when the buffer is full and before the shell forks, execs,
+ * exits, or prompts for input. */
+static int xtrace_fd = -1;
+static xstrbuf_T xtrace_output = { .contents = NULL };
+#define XTRACE_OUTPUT_SIZE 4096
+/* The time when the last trace was buffered. */
+static double xtrace_last_time;
+
 
 /* Resets `execstate' to the initial state. */
 void reset_execstate(bool reset_iteration)
@@ -308,11 +341,18 @@ bool need_break(void)
 void exec_and_or_lists(const and_or_T *a, bool finally_exit)
 {
     while (a != NULL && !need_break()) {
+        bool profiling = shopt_profiling;
+        if (profiling)
+            profile_enter_line(a->ao_pipelines->pl_commands->c_lineno);
+
         if (!a->ao_async)
             exec_pipelines(a->ao_pipelines, finally_exit && !a->next);
         else
             exec_pipelines_async(a->ao_pipelines);
 
+        if (profiling)
+            profile_leave_line();
+
         a = a->next;
     }
     if (finally_exit)
@@ -353,6 +393,11 @@ void exec_pipelines(const pipeline_T *p, bool finally_exit)
 /* Executes the pipelines asynchronously. */
 void exec_pipelines_async(const pipeline_T *p)
 {
+    if (!wait_for_job_slot()) {
+        laststatus = SIGINT + TERMSIGOFFSET;
+        return;
+    }
+
     if (p->next == NULL && !p->pl_neg) {
         exec_commands(p->pl_commands, E_ASYNC);
         return;
@@ -369,6 +414,7 @@ void exec_pipelines_async(const pipeline_T *p)
         ps->pr_status = JS_RUNNING;
         ps->pr_statuscode = 0;
         ps->pr_name = pipelines_to_wcs(p);
+        ps->pr_command = NULL;
 
         job->j_pgid = doing_job_control_now ? cpid : 0;
         job->j_status = JS_RUNNING;
@@ -404,6 +450,12 @@ void exec_commands(command_T *const cs, exec_T type)
 
     if (count == 1 && type != E_ASYNC) {
         exec_one_command(cs, /* finally_exit = */ short_circuit);
+        if (lastrusage_pending) {
+            wchar_t *name = command_to_wcs(cs, false);
+            log_rusage(&lastrusage, name);
+            free(name);
+            lastrusage_pending = false;
+        }
         goto done;
     }
 
@@ -439,12 +491,14 @@ exec_one_command: /* child process */
             p->pr_status = JS_RUNNING;
             // p->pr_statuscode = ?; // The process is still running.
             p->pr_name = NULL; // The actual name is given later.
+            p->pr_command = NULL;
         } else {
             /* parent process: fork failed */
             p->pr_pid = 0;
             p->pr_status = JS_DONE;
             p->pr_statuscode = forkstatus = Exit_NOEXEC;
             p->pr_name = NULL;
+            p->pr_command = NULL;
         }
     }
 
@@ -472,12 +526,19 @@ exec_one_command: /* child process */
     }
 
     if (job->j_status == JS_DONE) {
+        if (type != E_ASYNC) {
+            record_job_rusage(job);
+            if (lastrusage_pending) {
+                log_pipeline_rusage(cs, job);
+                lastrusage_pending = false;
+            }
+        }
         notify_signaled_job(ACTIVE_JOBNO);
         remove_job(ACTIVE_JOBNO);
     } else {
-        /* name the job processes */
+        /* remember the commands to name the job processes when needed */
         for (c = cs, p = job->j_procs; c != NULL; c = c->next, p++)
-            p->pr_name = command_to_wcs(c, false);
+            p->pr_command = comsdup(c);
 
         /* remember the suspended job */
         add_job(type == E_NORMAL || shopt_curasync);
@@ -492,6 +553,20 @@ done:
         exit_shell();
 }
 
+/* Prints the resource usage of each process of the specified finished job
+ * that was created from pipeline `cs'. */
+void log_pipeline_rusage(const command_T *cs, const job_T *job)
+{
+    const process_T *p = job->j_procs;
+    for (const command_T *c = cs; c != NULL; c = c->next, p++) {
+        if (p->pr_pid == 0)
+            continue;
+        wchar_t *name = command_to_wcs(c, false);
+        log_rusage(&p->pr_rusage, name);
+        free(name);
+    }
+}
+
 size_t number_of_commands_in_pipeline(const command_T *c)
 {
     size_t count = 1;
@@ -744,9 +819,18 @@ bool exec_simple_command_with_words(
     if (argv0 == NULL)
         argv0 = xstrdup("");
 
+    /* check if the command is a special built-in or function */
+    commandinfo_T cmdinfo;
+    search_command(argv0, argv[0], &cmdinfo, SCT_BUILTIN | SCT_FUNCTION);
+
     /* open redirections */
+    /* The read built-in can read a here-document or here-string directly from
+     * memory, so we don't need a pipe for it. */
     savefd_T *savefd;
-    if (!open_redirections(c->c_redirs, &savefd)) {
+    bool redirok = is_read_builtin(&cmdinfo)
+        ? open_redirections_for_reader(c->c_redirs, &savefd)
+        : open_redirections(c->c_redirs, &savefd);
+    if (!redirok) {
         /* On redirection error, the command is not executed. */
         laststatus = Exit_REDIRERR;
         if (posixly_correct && !is_interactive_now && is_special_builtin(argv0))
@@ -755,10 +839,6 @@ bool exec_simple_command_with_words(
     }
 
     last_assign = c->c_assigns;
-
-    /* check if the command is a special built-in or function */
-    commandinfo_T cmdinfo;
-    search_command(argv0, argv[0], &cmdinfo, SCT_BUILTIN | SCT_FUNCTION);
     special_builtin_executed = (cmdinfo.type == CT_SPECIALBUILTIN);
 
     /* open a temporary variable environment */
@@ -840,10 +920,17 @@ void print_xtrace(void *const *argv)
             && !(le_state & LE_STATE_ACTIVE)
 #endif
             ) {
-        bool first = true;
-
         // Disallow recursion in case $PS4 contains a command substitution
         // that may trigger another xtrace, which would be an infinite loop
+        if (xtrace_fd >= 0) {
+            expanding_ps4 = true;
+            buffer_xtrace(argv, tracevars);
+            expanding_ps4 = false;
+            goto done;
+        }
+
+        bool first = true;
+
         expanding_ps4 = true;
         struct promptset_T prompt = get_prompt(4);
         expanding_ps4 = false;
@@ -871,12 +958,89 @@ void print_xtrace(void *const *argv)
         print_prompt(PROMPT_RESET);
         free_prompt(prompt);
     }
+done:
     if (xtrace_buffer.contents != NULL) {
         wb_destroy(&xtrace_buffer);
         xtrace_buffer.contents = NULL;
     }
 }
 
+/* Appends a trace to `xtrace_output'.
+ * The trace line is prefixed with the current monotonic time and the time
+ * elapsed since the previous trace, both in seconds. $PS4 is expanded by
+ * `get_xtrace_prompt', which caches the result. */
+void buffer_xtrace(void *const *argv, bool tracevars)
+{
+    static xwcsbuf_T line = { .contents = NULL };
+
+    double now = monotonic_time();
+    if (xtrace_output.contents == NULL) {
+        sb_initwithmax(&xtrace_output, XTRACE_OUTPUT_SIZE);
+        xtrace_last_time = now;
+    }
+    if (line.contents == NULL)
+        wb_init(&line);
+
+    wb_wprintf(&line, L"%.6f %.6f ", now, now - xtrace_last_time);
+    xtrace_last_time = now;
+    wb_cat(&line, get_xtrace_prompt());
+
+    bool first = true;
+    if (tracevars) {
+        wb_cat(&line, xtrace_buffer.contents + 1);
+        first = false;
+    }
+    if (argv != NULL) {
+        for (void *const *a = argv; *a != NULL; a++) {
+            if (!first)
+                wb_wccat(&line, L' ');
+            first = false;
+            wb_catfree(&line, quote_as_word(*a));
+        }
+    }
+    wb_wccat(&line, L'\n');
+
+    mbstate_t state;
+    memset(&state, 0, sizeof state);
+    sb_wcscat(&xtrace_output, line.contents, &state);
+    wb_clear(&line);
+
+    if (xtrace_output.length >= XTRACE_OUTPUT_SIZE)
+        flush_xtrace();
+}
+
+/* Writes out the traces accumulated in `xtrace_output'.
+ * If the traces cannot be written, an error message is printed and the traces
+ * are discarded. */
+void flush_xtrace(void)
+{
+    if (xtrace_output.contents == NULL || xtrace_output.length == 0)
+        return;
+    if (xtrace_fd >= 0)
+        if (!write_all(xtrace_fd, xtrace_output.contents,
+                    xtrace_output.length))
+            xerror(errno, Ngt("cannot write the trace to file descriptor %d"),
+                    xtrace_fd);
+    sb_clear(&xtrace_output);
+}
+
+/* Writes out the accumulated traces if `fd' is the file descriptor to which
+ * traces are written. This function must be called before `fd' is redirected
+ * or closed so that the traces are written to the original file. */
+void flush_xtrace_for(int fd)
+{
+    if (fd == xtrace_fd)
+        flush_xtrace();
+}
+
+/* Sets the file descriptor to which traces are written.
+ * If `fd' is negative, traces are printed to the standard error. */
+void set_xtrace_fd(int fd)
+{
+    flush_xtrace();
+    xtrace_fd = fd;
+}
+
 /* Searches for a command.
  * The result is assigned to `*ci'.
  * `name' and `wname' must contain the same string value.
@@ -981,6 +1145,21 @@ bool is_special_builtin(const char *cmdname)
     return bi != NULL && bi->type == BI_SPECIAL;
 }
 
+/* Returns true iff the specified command is the read built-in. */
+bool is_read_builtin(const commandinfo_T *ci)
+{
+    switch (ci->type) {
+        case CT_SPECIALBUILTIN:
+        case CT_MANDATORYBUILTIN:
+        case CT_ELECTIVEBUILTIN:
+        case CT_EXTENSIONBUILTIN:
+        case CT_SUBSTITUTIVEBUILTIN:
+            return ci->ci_builtin == read_builtin;
+        default:
+            return false;
+    }
+}
+
 /* Executes $COMMAND_NOT_FOUND_HANDLER if any.
  * `argv' is set to the positional parameters of the environment in which the
  * handler is executed.
@@ -1064,8 +1243,13 @@ wchar_t **invoke_simple_command(
 
         current_builtin_name = savecbn;
         break;
-    case CT_FUNCTION:
+    case CT_FUNCTION:;
+        bool profiling = shopt_profiling;
+        if (profiling)
+            profile_enter_function(argv[0]);
         exec_function_body(ci->ci_function, &argv[1], finally_exit, false);
+        if (profiling)
+            profile_leave_function();
         break;
     }
     if (finally_exit)
@@ -1093,6 +1277,7 @@ void exec_external_program(
 
     restore_signals(true);
 
+    flush_xtrace();
     xexecve(path, mbsargv, envs);
     int saveerrno = errno;
     if (saveerrno != ENOEXEC) {
@@ -1305,6 +1490,11 @@ void exec_for(const command_T *c, bool finally_exit)
         words = v.values;
     }
 
+    if (c->c_forjobs != NULL) {
+        exec_for_parallel(c, count, words);
+        goto finish;
+    }
+
 #define CHECK_LOOP                                      \
     if (execstate.breakloopnest < execstate.loopnest) { \
         goto done;                                      \
@@ -1348,6 +1538,254 @@ finish:
         exit_shell();
 }
 
+/* Executes the iterations of the for loop `c' in parallel subshells.
+ * `words' is the array of the `count' words to assign to the loop variable,
+ * which is freed in this function.
+ * At most `c_forjobs' subshells run at a time. If `c_forkeep' is true, the
+ * standard output of each subshell is buffered in a temporary file and copied
+ * to the standard output of the shell in the order of the words.
+ * If an iteration performs the "break" built-in, no more iterations are
+ * started, but the running ones are waited for.
+ * The exit status is that of the first failed iteration in the order of the
+ * words, or zero if all the iterations succeeded. */
+void exec_for_parallel(const command_T *c, int count, void **words)
+{
+    assert(c->c_forjobs != NULL);
+
+    unsigned long maxjobs = 0;
+    wchar_t *jobs = expand_single(c->c_forjobs, TT_SINGLE, Q_WORD, ES_NONE);
+    if (jobs == NULL) {
+        laststatus = Exit_EXPERROR;
+        apply_errexit_errreturn(NULL);
+        goto free_words;
+    }
+    if (!xwcstoul(jobs, 10, &maxjobs) || maxjobs == 0) {
+        xerror(0, Ngt("`%ls' is not a valid number of parallel jobs"), jobs);
+        free(jobs);
+        laststatus = Exit_ERROR;
+        goto free_words;
+    }
+    free(jobs);
+
+    /* The break pipe is written to by an iteration that performs "break". */
+    int breakpipe[2];
+    if (pipe(breakpipe) < 0) {
+        xerror(errno, Ngt("cannot open a pipe"));
+        laststatus = Exit_NOEXEC;
+        goto free_words;
+    }
+    breakpipe[PIPE_IN] = move_to_shellfd(breakpipe[PIPE_IN]);
+    breakpipe[PIPE_OUT] = move_to_shellfd(breakpipe[PIPE_OUT]);
+    if (breakpipe[PIPE_IN] < 0 || breakpipe[PIPE_OUT] < 0) {
+        xerror(errno, Ngt("cannot open a pipe"));
+        for (int i = 0; i < 2; i++) {
+            if (breakpipe[i] >= 0) {
+                remove_shellfd(breakpipe[i]);
+                xclose(breakpipe[i]);
+            }
+        }
+        laststatus = Exit_NOEXEC;
+        goto free_words;
+    }
+    fcntl(breakpipe[PIPE_IN], F_SETFL,
+            fcntl(breakpipe[PIPE_IN], F_GETFL) | O_NONBLOCK);
+
+    paralleliter_T *iters = xmallocn(count, sizeof *iters);
+    int launched = 0, emitted = 0, status = Exit_SUCCESS;
+    unsigned long running = 0;
+    bool stop = false;
+
+    for (;;) {
+        /* collect finished iterations */
+        for (int i = emitted; i < launched; i++) {
+            paralleliter_T *it = &iters[i];
+            if (it->done)
+                continue;
+            job_T *job = get_job(it->jobnumber);
+            if (job->j_status != JS_DONE)
+                continue;
+            it->status = calc_status_of_job(job);
+            it->done = true;
+            remove_job(it->jobnumber);
+            running--;
+        }
+
+        char dummy;
+        if (read(breakpipe[PIPE_IN], &dummy, 1) > 0)
+            stop = true;
+        if (is_interrupted())
+            stop = true;
+
+        /* emit the output of finished iterations in order */
+        while (emitted < launched && iters[emitted].done) {
+            paralleliter_T *it = &iters[emitted++];
+            if (it->outfd >= 0) {
+                copy_parallel_output(it->outfd);
+                remove_shellfd(it->outfd);
+                xclose(it->outfd);
+                it->outfd = -1;
+            }
+            if (status == Exit_SUCCESS)
+                status = it->status;
+        }
+
+        /* With -k, the output of an iteration remains buffered until all the
+         * preceding iterations have finished, so the number of pending
+         * buffers is limited to `maxjobs' as well as the number of running
+         * iterations. */
+        if (!stop && launched < count && running < maxjobs &&
+                (!c->c_forkeep ||
+                 (unsigned long) (launched - emitted) < maxjobs)) {
+            paralleliter_T *it = &iters[launched];
+            it->done = false;
+            if (c->c_forkeep) {
+                it->outfd = open_parallel_output();
+                if (it->outfd < 0) {
+                    it->done = true;
+                    it->status = Exit_NOEXEC;
+                    stop = true;
+                    launched++;
+                    continue;
+                }
+            } else {
+                it->outfd = -1;
+            }
+            it->jobnumber = start_parallel_iteration(c, words[launched],
+                    it->outfd, breakpipe[PIPE_OUT]);
+            if (it->jobnumber == 0) {
+                it->done = true;
+                it->status = Exit_NOEXEC;
+                stop = true;
+            } else {
+                running++;
+            }
+            launched++;
+            continue;
+        }
+
+        if (running == 0)
+            break;
+        wait_for_sigchld(false, false);
+    }
+
+    assert(emitted == launched);
+    free(iters);
+    remove_shellfd(breakpipe[PIPE_IN]);
+    xclose(breakpipe[PIPE_IN]);
+    remove_shellfd(breakpipe[PIPE_OUT]);
+    xclose(breakpipe[PIPE_OUT]);
+    laststatus = status;
+
+free_words:
+    for (int i = 0; i < count; i++)
+        free(words[i]);
+    free(words);
+}
+
+/* Opens an unlinked temporary file to buffer the output of an iteration of a
+ * parallel for loop. Returns the file descriptor, which is a shell FD, or -1 on
+ * failure. */
+int open_parallel_output(void)
+{
+    char *tempfile;
+    int fd = create_temporary_file(&tempfile, "", 0);
+    if (fd < 0) {
+        xerror(errno, Ngt("cannot create a temporary file"));
+        return -1;
+    }
+    if (unlink(tempfile) < 0)
+        xerror(errno, Ngt("failed to remove temporary file `%s'"), tempfile);
+    free(tempfile);
+    fd = move_to_shellfd(fd);
+    if (fd < 0)
+        xerror(errno, Ngt("cannot create a temporary file"));
+    return fd;
+}
+
+/* Copies the contents of the temporary file `fd' to the standard output. */
+void copy_parallel_output(int fd)
+{
+    char buf[BUFSIZ];
+    ssize_t size;
+
+    if (lseek(fd, 0, SEEK_SET) != 0)
+        return;
+    while ((size = read(fd, buf, sizeof buf)) != 0) {
+        if (size < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (!write_all(STDOUT_FILENO, buf, (size_t) size))
+            break;
+    }
+}
+
+/* Starts a subshell that executes an iteration of the parallel for loop `c'
+ * with the loop variable set to `word'.
+ * If `outfd' is non-negative, the standard output of the subshell is
+ * redirected to it. `breakfd' is the writing end of the break pipe.
+ * Both are shell FDs, which are excluded from the shell FDs during `fork' so
+ * that they are not closed in the subshell like the other shell FDs.
+ * Returns the job number of the new subshell, or zero if failed to fork. */
+size_t start_parallel_iteration(const command_T *c, const wchar_t *word,
+        int outfd, int breakfd)
+{
+    remove_shellfd(breakfd);
+    if (outfd >= 0)
+        remove_shellfd(outfd);
+
+    pid_t cpid = fork_and_reset(-1, false, t_tstp);
+
+    if (cpid != 0) {
+        add_shellfd(breakfd);
+        if (outfd >= 0)
+            add_shellfd(outfd);
+    }
+
+    if (cpid > 0) {
+        /* parent process: add a new job */
+        job_T *job = xmalloc(add(sizeof *job, sizeof *job->j_procs));
+        process_T *ps = job->j_procs;
+
+        ps->pr_pid = cpid;
+        ps->pr_status = JS_RUNNING;
+        ps->pr_statuscode = 0;
+        ps->pr_name = malloc_wprintf(L"%ls=%ls", c->c_forname, word);
+        ps->pr_command = NULL;
+
+        job->j_pgid = 0;
+        job->j_status = JS_RUNNING;
+        job->j_statuschanged = false;
+        job->j_legacy = false;
+        job->j_nonotify = true;
+        job->j_pcount = 1;
+
+        set_active_job(job);
+        return add_job(false);
+    } else if (cpid == 0) {
+        /* child process: execute the loop body and then exit */
+        add_shellfd(breakfd);
+        if (outfd >= 0) {
+            xdup2(outfd, STDOUT_FILENO);
+            xclose(outfd);
+        }
+
+        execstate.loopnest = execstate.breakloopnest = 1;
+        if (set_variable(c->c_forname, xwcsdup(word), SCOPE_GLOBAL, false)) {
+            exec_and_or_lists(c->c_forcmds, false);
+            if (execstate.breakloopnest < execstate.loopnest)
+                write_all(breakfd, "", 1);
+        } else {
+            laststatus = Exit_ASSGNERR;
+        }
+        exit_shell();
+    } else {
+        /* fork failure */
+        return 0;
+    }
+}
+
 /* Executes the while/until command. */
 /* The exit status of a while/until command is that of `c_whlcmds' executed
  * last.  If `c_whlcmds' is not executed at all, the status is 0 regardless of
@@ -1498,6 +1936,8 @@ fork_and_wait_T fork_and_wait(sigtype_T sigtype)
  * Returns the return value of `fork'. */
 pid_t fork_and_reset(pid_t pgid, bool fg, sigtype_T sigtype)
 {
+    flush_xtrace();
+
     sigset_t savemask;
     if (sigtype & (t_quitint | t_tstp)) {
         /* block all signals to prevent the race condition */
@@ -1517,6 +1957,7 @@ pid_t fork_and_reset(pid_t pgid, bool fg, sigtype_T sigtype)
             /* parent process */
             if (doing_job_control_now && pgid >= 0)
                 setpgid(cpid, pgid);
+            profile_fork_count++;
         }
         if (sigtype & (t_quitint | t_tstp))
             sigprocmask(SIG_SETMASK, &savemask, NULL);
@@ -1618,9 +2059,13 @@ wchar_t *exec_command_substitution(const embedcmd_T *cmdsub)
 
         /* wait for the child to finish */
         int savelaststatus = laststatus;
+        struct rusage savelastrusage = lastrusage;
+        bool savelastrusage_pending = lastrusage_pending;
         wait_for_child(cpid, 0, false);
         lastcmdsubstatus = laststatus;
         laststatus = savelaststatus;
+        lastrusage = savelastrusage;
+        lastrusage_pending = savelastrusage_pending;
 
         /* trim trailing newlines and return */
         size_t len = buf.length;
@@ -1745,8 +2190,8 @@ bool autoload_completion_function_file(
     if (mbsfilename == NULL)
         return false;
 
-    char *path = which(mbsfilename, get_path_array(PA_LOADPATH),
-            is_readable_regular);
+    wchar_t *code;
+    char *path = search_loadpath(mbsfilename, &code);
     if (path == NULL) {
         le_compdebug("file \"%s\" was not found in $YASH_LOADPATH",
                 mbsfilename);
@@ -1754,11 +2199,15 @@ bool autoload_completion_function_file(
         return false;
     }
 
-    int fd = move_to_shellfd(open(path, O_RDONLY));
-    if (fd < 0) {
-        le_compdebug("cannot open file \"%s\"", path);
-        free(path);
-        return false;
+    int fd = -1;
+    if (code == NULL) {
+        fd = move_to_shellfd(open(path, O_RDONLY));
+        if (fd < 0) {
+            le_compdebug("cannot open file \"%s\"", path);
+            free(path);
+            free(mbsfilename);
+            return false;
+        }
     }
 
     execstate_T *saveexecstate = save_execstate();
@@ -1769,17 +2218,28 @@ bool autoload_completion_function_file(
     open_new_environment(false);
     set_positional_parameters((void *[]) { (void *) cmdname, NULL });
 
-    le_compdebug("executing file \"%s\" (autoload)", path);
-    exec_input(fd, mbsfilename, 0);
-    le_compdebug("finished executing file \"%s\"", path);
+    if (code != NULL) {
+        le_compdebug("executing \"%s\" in bundle \"%s\" (autoload)",
+                mbsfilename, path);
+        exec_script_wcs(code, mbsfilename, 0);
+        le_compdebug("finished executing \"%s\" in bundle \"%s\"",
+                mbsfilename, path);
+    } else {
+        le_compdebug("executing file \"%s\" (autoload)", path);
+        exec_input(fd, mbsfilename, 0);
+        le_compdebug("finished executing file \"%s\"", path);
+    }
 
     close_current_environment();
     posixly_correct = saveposix;
     laststatus = savelaststatus;
     cancel_return();
     restore_execstate(saveexecstate);
-    remove_shellfd(fd);
-    xclose(fd);
+    if (fd >= 0) {
+        remove_shellfd(fd);
+        xclose(fd);
+    }
+    free(code);
     free(path);
     free(mbsfilename);
     return true;
@@ -1835,6 +2295,10 @@ static void print_command_absolute_path(
 static void print_command_path(
         const char *name, const char *path, bool humanfriendly)
     __attribute__((nonnull));
+static bool open_coproc_pipe(int fds[2])
+    __attribute__((nonnull));
+static void remember_coproc_fd(int fd);
+static void forget_closed_coproc_fds(void);
 
 /* Options for the "break", "continue" and "eval" built-ins. */
 const struct xgetopt_T iter_options[] = {
@@ -2097,9 +2561,9 @@ int dot_builtin(int argc, void **argv)
     }
 
     char *path;
+    wchar_t *code = NULL;
     if (autoload) {
-        path = which(mbsfilename, get_path_array(PA_LOADPATH),
-                is_readable_regular);
+        path = search_loadpath(mbsfilename, &code);
         if (path == NULL) {
             xerror(0, Ngt("file `%s' was not found in $YASH_LOADPATH"),
                     mbsfilename);
@@ -2119,13 +2583,18 @@ int dot_builtin(int argc, void **argv)
         path = mbsfilename;
     }
 
-    int fd = move_to_shellfd(open(path, O_RDONLY));
+    int fd = -1;
+    if (code == NULL) {
+        fd = move_to_shellfd(open(path, O_RDONLY));
+        if (fd < 0) {
+            xerror(errno, Ngt("cannot open file `%s'"), mbsfilename);
+            if (path != mbsfilename)
+                free(path);
+            goto error;
+        }
+    }
     if (path != mbsfilename)
         free(path);
-    if (fd < 0) {
-        xerror(errno, Ngt("cannot open file `%s'"), mbsfilename);
-        goto error;
-    }
 
     if (has_args) {
         open_new_environment(false);
@@ -2138,13 +2607,20 @@ int dot_builtin(int argc, void **argv)
     bool saveser = suppresserrreturn;
     suppresserrreturn = false;
 
-    exec_input(fd, mbsfilename, enable_alias ? XIO_SUBST_ALIAS : 0);
+    exec_input_options_T options = enable_alias ? XIO_SUBST_ALIAS : 0;
+    if (code != NULL)
+        exec_script_wcs(code, mbsfilename, options);
+    else
+        exec_input(fd, mbsfilename, options);
 
     cancel_return();
     suppresserrreturn = saveser;
     restore_execstate(saveexecstate);
-    remove_shellfd(fd);
-    xclose(fd);
+    if (fd >= 0) {
+        remove_shellfd(fd);
+        xclose(fd);
+    }
+    free(code);
     free(mbsfilename);
 
     if (has_args) {
@@ -2584,6 +3060,210 @@ const char type_syntax[] = Ngt(
 
 #endif
 
+/* Shell-side ends of the pipes opened by the "coproc" built-in.
+ * They are closed in new coprocesses so that a coprocess that does not exec an
+ * external command does not keep other coprocesses' pipes open. The device and
+ * i-node numbers identify the pipe in case the user has closed the file
+ * descriptor and reused its number. */
+static struct coprocfd_T {
+    int fd;
+    dev_t dev;
+    ino_t ino;
+} *coprocfds = NULL;
+static size_t coprocfdcount = 0;
+
+/* Options for the "coproc" built-in. */
+const struct xgetopt_T coproc_options[] = {
+    { L'n', L"name", OPTARG_REQUIRED, true,  NULL, },
+#if YASH_ENABLE_HELP
+    { L'-', L"help", OPTARG_NONE,     false, NULL, },
+#endif
+    { L'\0', NULL, 0, false, NULL, },
+};
+
+/* The "coproc" built-in, which accepts the following option:
+ *  -n name: name of the array variable to which the file descriptors are
+ *           assigned (default: COPROC) */
+int coproc_builtin(int argc, void **argv)
+{
+    const wchar_t *name = L VAR_COPROC;
+
+    const struct xgetopt_T *opt;
+    xoptind = 0;
+    while ((opt = xgetopt(argv, coproc_options, XGETOPT_POSIX)) != NULL) {
+        switch (opt->shortopt) {
+            case L'n':  name = xoptarg;  break;
+#if YASH_ENABLE_HELP
+            case L'-':
+                return print_builtin_help(ARGV(0));
+#endif
+            default:
+                return Exit_ERROR;
+        }
+    }
+
+    if (xoptind == argc)
+        return insufficient_operands_error(1);
+    if (!is_name(name)) {
+        xerror(0, Ngt("`%ls' is not a valid variable name"), name);
+        return Exit_ERROR;
+    }
+
+    char *argv0 = malloc_wcstombs(ARGV(xoptind));
+    if (argv0 == NULL) {
+        xerror(EILSEQ, NULL);
+        return Exit_NOTFOUND;
+    }
+
+    if (!wait_for_job_slot()) {
+        free(argv0);
+        return SIGINT + TERMSIGOFFSET;
+    }
+
+    int tocoproc[2], fromcoproc[2];
+    if (!open_coproc_pipe(tocoproc)) {
+        free(argv0);
+        return Exit_FAILURE;
+    }
+    if (!open_coproc_pipe(fromcoproc)) {
+        xclose(tocoproc[PIPE_IN]);
+        xclose(tocoproc[PIPE_OUT]);
+        free(argv0);
+        return Exit_FAILURE;
+    }
+
+    commandinfo_T ci;
+    search_command(argv0, ARGV(xoptind), &ci,
+            SCT_EXTERNAL | SCT_BUILTIN | SCT_FUNCTION);
+
+    forget_closed_coproc_fds();
+
+    pid_t cpid = fork_and_reset(0, false, t_quitint);
+    if (cpid == 0) {
+        /* child process: execute the command and then exit */
+        for (size_t i = 0; i < coprocfdcount; i++)
+            xclose(coprocfds[i].fd);
+        xclose(tocoproc[PIPE_OUT]);
+        xclose(fromcoproc[PIPE_IN]);
+        xdup2(tocoproc[PIPE_IN], STDIN_FILENO);
+        xclose(tocoproc[PIPE_IN]);
+        xdup2(fromcoproc[PIPE_OUT], STDOUT_FILENO);
+        xclose(fromcoproc[PIPE_OUT]);
+        wchar_t **namep = invoke_simple_command(
+                &ci, argc - xoptind, argv0, &argv[xoptind], true);
+        (void) namep;
+        assert(false);
+    }
+
+    free(argv0);
+    xclose(tocoproc[PIPE_IN]);
+    xclose(fromcoproc[PIPE_OUT]);
+    if (cpid < 0) {
+        xclose(tocoproc[PIPE_OUT]);
+        xclose(fromcoproc[PIPE_IN]);
+        return Exit_FAILURE;
+    }
+
+    /* parent process: add a new job */
+    job_T *job = xmalloc(add(sizeof *job, sizeof *job->j_procs));
+    process_T *ps = job->j_procs;
+
+    ps->pr_pid = cpid;
+    ps->pr_status = JS_RUNNING;
+    ps->pr_statuscode = 0;
+    ps->pr_name = joinwcsarray(&argv[xoptind], L" ");
+    ps->pr_command = NULL;
+
+    job->j_pgid = doing_job_control_now ? cpid : 0;
+    job->j_status = JS_RUNNING;
+    job->j_statuschanged = true;
+    job->j_legacy = false;
+    job->j_nonotify = false;
+    job->j_pcount = 1;
+
+    set_active_job(job);
+    add_job(shopt_curasync);
+    lastasyncpid = cpid;
+
+    remember_coproc_fd(fromcoproc[PIPE_IN]);
+    remember_coproc_fd(tocoproc[PIPE_OUT]);
+
+    void **fds = xmallocn(3, sizeof *fds);
+    fds[0] = malloc_wprintf(L"%d", fromcoproc[PIPE_IN]);
+    fds[1] = malloc_wprintf(L"%d", tocoproc[PIPE_OUT]);
+    fds[2] = NULL;
+    if (!set_array(name, 2, fds, SCOPE_GLOBAL, false))
+        return Exit_FAILURE;
+    return Exit_SUCCESS;
+}
+
+/* Opens a pipe for a coprocess.
+ * The file descriptors are moved to 10 or above so that they do not conflict
+ * with file descriptors the user is likely to redirect. The close-on-exec flag
+ * is set for both ends so that other commands do not inherit them.
+ * On failure, prints an error message and returns false. */
+bool open_coproc_pipe(int fds[2])
+{
+    int p[2];
+    if (pipe(p) < 0)
+        goto fail;
+    for (int i = 0; i < 2; i++) {
+        fds[i] = fcntl(p[i], F_DUPFD, 10);
+        if (fds[i] < 0) {
+            int saveerrno = errno;
+            if (i > 0)
+                xclose(fds[0]);
+            xclose(p[0]);
+            xclose(p[1]);
+            errno = saveerrno;
+            goto fail;
+        }
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    xclose(p[0]);
+    xclose(p[1]);
+    return true;
+
+fail:
+    xerror(errno, Ngt("cannot open a pipe"));
+    return false;
+}
+
+/* Adds the specified file descriptor to `coprocfds'. */
+void remember_coproc_fd(int fd)
+{
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+        return;
+    coprocfds = xreallocn(coprocfds, coprocfdcount + 1, sizeof *coprocfds);
+    coprocfds[coprocfdcount++] = (struct coprocfd_T) {
+        .fd = fd, .dev = st.st_dev, .ino = st.st_ino, };
+}
+
+/* Removes from `coprocfds' the file descriptors that no longer refer to the
+ * pipes they were opened for. */
+void forget_closed_coproc_fds(void)
+{
+    size_t j = 0;
+    for (size_t i = 0; i < coprocfdcount; i++) {
+        struct stat st;
+        if (fstat(coprocfds[i].fd, &st) == 0
+                && st.st_dev == coprocfds[i].dev
+                && st.st_ino == coprocfds[i].ino)
+            coprocfds[j++] = coprocfds[i];
+    }
+    coprocfdcount = j;
+}
+
+#if YASH_ENABLE_HELP
+const char coproc_help[] = Ngt(
+"start a coprocess"
+);
+const char coproc_syntax[] = Ngt(
+"\tcoproc [-n name] command [argument...]\n"
+);
+#endif
+
 /* The "times" built-in. */
 int times_builtin(int argc __attribute__((unused)), void **argv)
 {
@@ -61,6 +61,9 @@ struct and_or_T;
 struct embedcmd_T;
 extern void exec_and_or_lists(const struct and_or_T *a, _Bool finally_exit);
 extern struct xwcsbuf_T *get_xtrace_buffer(void);
+extern void flush_xtrace(void);
+extern void flush_xtrace_for(int fd);
+extern void set_xtrace_fd(int fd);
 extern pid_t fork_and_reset(pid_t pgid, _Bool fg, sigtype_T sigtype);
 extern wchar_t *exec_command_substitution(const struct embedcmd_T *cmdsub)
     __attribute__((nonnull,malloc,warn_unused_result));
@@ -124,6 +127,13 @@ extern const char command_help[], command_syntax[], type_help[], type_syntax[];
 #endif
 extern const struct xgetopt_T command_options[];
 
+extern int coproc_builtin(int argc, void **argv)
+    __attribute__((nonnull));
+#if YASH_ENABLE_HELP
+extern const char coproc_help[], coproc_syntax[];
+#endif
+extern const struct xgetopt_T coproc_options[];
+
 extern int times_builtin(int argc, void **argv)
     __attribute__((nonnull));
 #if YASH_ENABLE_HELP
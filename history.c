@@ -38,6 +38,7 @@
 #include <wctype.h>
 #include "builtin.h"
 #include "exec.h"
+#include "hashtable.h"
 #include "job.h"
 #include "option.h"
 #include "path.h"
@@ -46,6 +47,7 @@
 #include "strbuf.h"
 #include "util.h"
 #include "variable.h"
+#include "xfnmatch.h"
 #include "yash.h"
 
 
@@ -119,6 +121,27 @@ static time_t now = (time_t) -1;
 /* If true, the history is locked, that is, readonly. */
 static bool hist_lock = false;
 
+/* The serial number of the next new entry. */
+static unsigned long next_serial = 0;
+
+#if YASH_ENABLE_LINEEDIT
+/* A posting list, that is, the list of entries whose value contains a trigram.
+ * The entries are sorted in the order of the history list. Only the elements
+ * of `entries' with indices from `start' (inclusive) to `end' (exclusive) are
+ * valid. */
+typedef struct posting_T {
+    char trigram[4];
+    size_t start, end, capacity;
+    histentry_T **entries;
+} posting_T;
+/* The trigram index used in history search.
+ * The keys are the trigrams (3-byte strings) and the values are pointers to
+ * the `posting_T' structures whose `trigram' member is the key.
+ * The index is built when history search is first performed; until then, the
+ * capacity of this hashtable is zero. */
+static hashtable_T trigram_index;
+#endif
+
 
 struct search_result_T {
     histlink_T *prev, *next;
@@ -146,6 +169,15 @@ static bool search_result_is_newer(
 static bool entry_is_newer(const histentry_T *e1, const histentry_T *e2)
     __attribute__((nonnull,pure));
 
+#if YASH_ENABLE_LINEEDIT
+static void index_entry(histentry_T *e)
+    __attribute__((nonnull));
+static void unindex_entry(const histentry_T *e)
+    __attribute__((nonnull));
+static void clear_index(void);
+static void free_posting(kvpair_T kv);
+#endif
+
 static void add_histfile_pid(pid_t pid);
 static void remove_histfile_pid(pid_t pid);
 static void clear_histfile_pids(void);
@@ -223,11 +255,17 @@ histentry_T *new_entry(unsigned number, time_t time, const char *line)
     histlist.Newest = new->Prev->next = &new->link;
     new->number = number;
     new->time = time;
+    new->serial = next_serial++;
     strcpy(new->value, line);
 
     histlist.count++;
     assert(histlist.count <= histsize);
 
+#if YASH_ENABLE_LINEEDIT
+    if (trigram_index.capacity > 0)
+        index_entry(new);
+#endif
+
     return new;
 }
 
@@ -251,6 +289,10 @@ void remove_entry(histentry_T *entry)
 {
     assert(!hist_lock);
     assert(&entry->link != Histlist);
+#if YASH_ENABLE_LINEEDIT
+    if (trigram_index.capacity > 0)
+        unindex_entry(entry);
+#endif
     entry->Prev->next = entry->Next;
     entry->Next->prev = entry->Prev;
     histlist.count--;
@@ -290,6 +332,10 @@ void clear_all_entries(void)
     }
     histlist.Oldest = histlist.Newest = Histlist;
     histlist.count = 0;
+
+#if YASH_ENABLE_LINEEDIT
+    clear_index();
+#endif
 }
 
 /* Searches for the entry that has the specified `number'.
@@ -1165,6 +1211,171 @@ void end_using_history(void)
     hist_lock = false;
 }
 
+/* Searches the history for an entry whose value matches the specified pattern.
+ * The search starts from the entry next to `start' in the specified direction
+ * and the nearest matching entry is returned. `start' may be `Histlist', in
+ * which case the search starts from the oldest (if `forward' is true) or the
+ * newest entry. `literal' must be a string that is contained in the value of
+ * every entry matching `xfnm'. If `literal' is at least three bytes long, the
+ * entries that do not contain all of its trigrams are skipped without being
+ * tested against `xfnm'.
+ * Returns `Histlist' if no entry matches. */
+const histlink_T *search_history(const histlink_T *start, bool forward,
+        const xfnmatch_T *xfnm, const char *literal)
+{
+    size_t len = strlen(literal);
+    if (len < 3) {
+        const histlink_T *l = start;
+        for (;;) {
+            l = forward ? l->next : l->prev;
+            if (l == Histlist || xfnm_match(xfnm, ashistentry(l)->value) == 0)
+                return l;
+        }
+    }
+
+    if (trigram_index.capacity == 0) {
+        ht_init(&trigram_index, hashstr, htstrcmp);
+        for (histlink_T *l = histlist.Oldest; l != Histlist; l = l->next)
+            index_entry(ashistentry(l));
+    }
+
+    /* Only the entries in the shortest posting list of the trigrams need to be
+     * tested. */
+    const posting_T *posting = NULL;
+    for (size_t i = 0; i + 3 <= len; i++) {
+        char trigram[4] = { literal[i], literal[i + 1], literal[i + 2], '\0' };
+        const posting_T *p = ht_get(&trigram_index, trigram).value;
+        if (p == NULL)
+            return Histlist;
+        if (posting == NULL || p->end - p->start < posting->end - posting->start)
+            posting = p;
+    }
+    assert(posting != NULL);
+
+    /* Find the first entry to test by binary search. After the loop,
+     * the entries in the range [posting->start, index) are older than `start'
+     * and the others are not. */
+    size_t index;
+    if (start == Histlist) {
+        index = forward ? posting->start : posting->end;
+    } else {
+        unsigned long serial = ashistentry(start)->serial;
+        size_t lo = posting->start, hi = posting->end;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (posting->entries[mid]->serial < serial)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        index = lo;
+        if (forward && index < posting->end
+                && posting->entries[index]->serial == serial)
+            index++;
+    }
+
+    if (forward) {
+        for (; index < posting->end; index++)
+            if (xfnm_match(xfnm, posting->entries[index]->value) == 0)
+                return &posting->entries[index]->link;
+    } else {
+        while (index > posting->start) {
+            index--;
+            if (xfnm_match(xfnm, posting->entries[index]->value) == 0)
+                return &posting->entries[index]->link;
+        }
+    }
+    return Histlist;
+}
+
+/* Adds the specified entry to the posting lists of the trigrams contained in
+ * its value. The entry must be newer than any entry already in the index. */
+void index_entry(histentry_T *e)
+{
+    for (size_t i = 0; e->value[i] != '\0'
+            && e->value[i + 1] != '\0' && e->value[i + 2] != '\0'; i++) {
+        char trigram[4] = { e->value[i], e->value[i + 1], e->value[i + 2], '\0' };
+        posting_T *p = ht_get(&trigram_index, trigram).value;
+        if (p == NULL) {
+            p = xmalloc(sizeof *p);
+            memcpy(p->trigram, trigram, sizeof p->trigram);
+            p->start = p->end = p->capacity = 0;
+            p->entries = NULL;
+            ht_set(&trigram_index, p->trigram, p);
+        } else if (p->end > p->start && p->entries[p->end - 1] == e) {
+            continue;  /* the trigram appeared earlier in the same value */
+        }
+
+        if (p->end == p->capacity) {
+            if (p->start > 0) {
+                /* reclaim the space of the removed oldest entries */
+                memmove(p->entries, &p->entries[p->start],
+                        (p->end - p->start) * sizeof *p->entries);
+                p->end -= p->start;
+                p->start = 0;
+            }
+            if (p->end == p->capacity) {
+                p->capacity = (p->capacity == 0) ? 4 : mul(p->capacity, 2);
+                p->entries = xreallocn(p->entries,
+                        p->capacity, sizeof *p->entries);
+            }
+        }
+        p->entries[p->end++] = e;
+    }
+}
+
+/* Removes the specified entry from the posting lists of the trigrams contained
+ * in its value. */
+void unindex_entry(const histentry_T *e)
+{
+    for (size_t i = 0; e->value[i] != '\0'
+            && e->value[i + 1] != '\0' && e->value[i + 2] != '\0'; i++) {
+        char trigram[4] = { e->value[i], e->value[i + 1], e->value[i + 2], '\0' };
+        posting_T *p = ht_get(&trigram_index, trigram).value;
+        if (p == NULL)
+            continue;  /* the trigram appeared earlier in the same value */
+
+        /* Entries are usually removed from either end of the list. */
+        if (p->entries[p->start] == e) {
+            p->start++;
+        } else if (p->entries[p->end - 1] == e) {
+            p->end--;
+        } else {
+            size_t lo = p->start, hi = p->end;
+            while (lo < hi) {
+                size_t mid = lo + (hi - lo) / 2;
+                if (p->entries[mid]->serial < e->serial)
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            if (lo == p->end || p->entries[lo] != e)
+                continue;  /* the trigram appeared earlier in the same value */
+            memmove(&p->entries[lo], &p->entries[lo + 1],
+                    (p->end - lo - 1) * sizeof *p->entries);
+            p->end--;
+        }
+
+        if (p->start == p->end)
+            free_posting(ht_remove(&trigram_index, trigram));
+    }
+}
+
+/* Removes all the posting lists from the trigram index. */
+void clear_index(void)
+{
+    if (trigram_index.capacity > 0)
+        ht_clear(&trigram_index, free_posting);
+}
+
+/* Frees the posting list that is the value of the specified key-value pair. */
+void free_posting(kvpair_T kv)
+{
+    posting_T *p = kv.value;
+    free(p->entries);
+    free(p);
+}
+
 #endif /* YASH_ENABLE_LINEEDIT */
 
 
@@ -36,6 +36,7 @@ typedef struct histentry_T {
     histlink_T link;
     unsigned number;
     time_t time;
+    unsigned long serial;
     char value[];
 } histentry_T;
 #define Prev link.prev
@@ -48,6 +49,8 @@ typedef struct histentry_T {
  * The limit is no less than $HISTSIZE, so all the entries have different
  * numbers anyway. */
 /* When the time is unknown, `time' is -1. */
+/* The `serial' is increased for each entry and never wraps around, so it tells
+ * the order of entries in the list. */
 
 /* The structure type of the history list. */
 typedef struct histlist_T {
@@ -81,6 +84,10 @@ const histlink_T *get_history_entry(unsigned number)
 #if YASH_ENABLE_LINEEDIT
 extern void start_using_history(void);
 extern void end_using_history(void);
+struct xfnmatch_T;
+extern const histlink_T *search_history(const histlink_T *start, _Bool forward,
+        const struct xfnmatch_T *xfnm, const char *literal)
+    __attribute__((nonnull));
 #endif
 
 extern int fc_builtin(int argc, void **argv)
@@ -120,6 +120,8 @@ inputresult_T read_input(
     for (;;) {
         if (info->bufpos >= info->bufmax) {
 read_input:  /* if there's nothing in the buffer, read the next input */
+            if (info->fd < 0)
+                goto end;  /* in-memory contents are exhausted */
             switch (wait_for_input(info->fd, trap, -1)) {
                 case W_READY:
                     break;
@@ -186,6 +188,26 @@ end:
         return status;
 }
 
+/* Creates a new `input_file_info_T' whose buffer contains a copy of the first
+ * `len' bytes of `s'. Reading from the result with `read_input' returns the
+ * contents of the buffer and then EOF without reading any file descriptor.
+ * The result must be freed by the caller. */
+struct input_file_info_T *new_input_string_info(const char *s, size_t len)
+{
+    /* `bufsize' is made larger than one byte so that `read_input' does not
+     * try `optimized_read_input'. */
+    size_t bufsize = add(len, 1);
+    struct input_file_info_T *info
+        = xmallocs(sizeof *info, bufsize, sizeof *info->buf);
+    info->fd = -1;
+    info->bufpos = 0;
+    info->bufmax = len;
+    info->bufsize = bufsize;
+    memcpy(info->buf, s, len);
+    memset(&info->state, 0, sizeof info->state);  // initial shift state
+    return info;
+}
+
 /* Checks if the file descriptor is seekable. */
 bool is_seekable_file(int fd)
 {
@@ -240,6 +262,7 @@ inputresult_T optimized_read_input(
 inputresult_T input_interactive(struct xwcsbuf_T *buf, void *inputinfo)
 {
     struct input_interactive_info_T *info = inputinfo;
+    flush_xtrace();
     if (info->prompttype == 1) {
         if (!posixly_correct)
             exec_variable_as_auxiliary_(VAR_PROMPT_COMMAND);
@@ -447,21 +470,31 @@ void print_prompt(const wchar_t *s)
     xwcsbuf_T buf;
 
     wb_init(&buf);
+    format_prompt(&buf, s);
+    fprintf(stderr, "%ls", buf.contents);
+    fflush(stderr);
+    wb_destroy(&buf);
+}
+
+/* Appends the specified prompt string to the buffer, processing the escape
+ * sequences as described for `print_prompt'. */
+void format_prompt(xwcsbuf_T *restrict buf, const wchar_t *restrict s)
+{
     while (*s != L'\0') {
         if (*s != L'\\') {
-            wb_wccat(&buf, *s);
+            wb_wccat(buf, *s);
         } else switch (*++s) {
-            default:     wb_wccat(&buf, *s);       break;
-            case L'\0':  wb_wccat(&buf, L'\\');    goto done;
-//          case L'\\':  wb_wccat(&buf, L'\\');    break;
-            case L'a':   wb_wccat(&buf, L'\a');    break;
-            case L'e':   wb_wccat(&buf, L'\033');  break;
-            case L'n':   wb_wccat(&buf, L'\n');    break;
-            case L'r':   wb_wccat(&buf, L'\r');    break;
-            case L'$':   wb_wccat(&buf, get_euid_marker());      break;
-            case L'j':   wb_wprintf(&buf, L"%zu", job_count());  break;
+            default:     wb_wccat(buf, *s);       break;
+            case L'\0':  wb_wccat(buf, L'\\');    return;
+//          case L'\\':  wb_wccat(buf, L'\\');    break;
+            case L'a':   wb_wccat(buf, L'\a');    break;
+            case L'e':   wb_wccat(buf, L'\033');  break;
+            case L'n':   wb_wccat(buf, L'\n');    break;
+            case L'r':   wb_wccat(buf, L'\r');    break;
+            case L'$':   wb_wccat(buf, get_euid_marker());      break;
+            case L'j':   wb_wprintf(buf, L"%zu", job_count());  break;
 #if YASH_ENABLE_HISTORY
-            case L'!':   wb_wprintf(&buf, L"%u", next_history_number());  break;
+            case L'!':   wb_wprintf(buf, L"%u", next_history_number());  break;
 #endif
             case L'[':
             case L']':
@@ -474,10 +507,35 @@ void print_prompt(const wchar_t *s)
         }
         s++;
     }
-done:
-    fprintf(stderr, "%ls", buf.contents);
-    fflush(stderr);
-    wb_destroy(&buf);
+}
+
+/* Returns the main part of the xtrace prompt with the escape sequences
+ * processed. If the value of the prompt variable contains no expansions or
+ * escapes, the result is cached and the variable is not re-parsed until its
+ * value changes. The returned string is valid until the next call. */
+const wchar_t *get_xtrace_prompt(void)
+{
+    static wchar_t *source = NULL;
+    static xwcsbuf_T result = { .contents = NULL };
+
+    const wchar_t *var = get_prompt_variable(L'4', L'\0');
+    if (source != NULL && wcscmp(source, var) == 0)
+        return result.contents;
+
+    free(source);
+    source = (wcspbrk(var, L"$`\\") == NULL) ? xwcsdup(var) : NULL;
+
+    wchar_t *prompt = expand_prompt_variable(L'4', L'\0');
+    if (posixly_correct)
+        prompt = escapefree(prompt, L"\\");
+
+    if (result.contents == NULL)
+        wb_init(&result);
+    else
+        wb_clear(&result);
+    format_prompt(&result, prompt);
+    free(prompt);
+    return result.contents;
 }
 
 wchar_t get_euid_marker(void)
@@ -55,10 +55,18 @@ typedef enum inputresult_T {
 } inputresult_T;
 
 struct xwcsbuf_T;
+extern void format_prompt(
+        struct xwcsbuf_T *restrict buf, const wchar_t *restrict s)
+    __attribute__((nonnull));
+extern const wchar_t *get_xtrace_prompt(void);
+
 struct input_file_info_T;
 extern inputresult_T read_input(
         struct xwcsbuf_T *buf, struct input_file_info_T *info, _Bool trap)
     __attribute__((nonnull));
+extern struct input_file_info_T *new_input_string_info(
+        const char *s, size_t len)
+    __attribute__((nonnull,malloc,warn_unused_result));
 
 /* The type of input functions.
  * An input function reads input and appends it to buffer `buf'.
@@ -94,7 +102,8 @@ struct input_file_info_T {
     size_t bufpos, bufmax, bufsize;
     char buf[];
 };
-/* `bufsize' is the size of `buf', which must be at least one byte. */
+/* `bufsize' is the size of `buf', which must be at least one byte.
+ * If `fd' is negative, the input is the contents of `buf' only. */
 
 /* to be used as `inputinfo' for `input_interactive' */
 struct input_interactive_info_T {
@@ -23,12 +23,18 @@
 #if HAVE_GETTEXT
 # include <libintl.h>
 #endif
+#if HAVE_PIDFD_OPEN
+# include <poll.h>
+#endif
 #include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if HAVE_PIDFD_OPEN
+# include <sys/pidfd.h>
+#endif
 #include <sys/wait.h>
 #include <unistd.h>
 #include <wchar.h>
@@ -36,11 +42,13 @@
 #include "builtin.h"
 #include "exec.h"
 #include "option.h"
+#include "parser.h"
 #include "plist.h"
 #include "redir.h"
 #include "sig.h"
 #include "strbuf.h"
 #include "util.h"
+#include "variable.h"
 #include "yash.h"
 #if YASH_ENABLE_LINEEDIT
 # include "xfnmatch.h"
@@ -51,38 +59,69 @@
 #endif
 
 
-static inline job_T *get_job(size_t jobnumber)
-    __attribute__((pure));
+#if HAVE_PIDFD_OPEN && !defined(pidfd_open)
+extern int pidfd_open(pid_t pid, unsigned int flags);
+#endif
+#if HAVE_WAIT4 && !defined(wait4)
+extern pid_t wait4(pid_t pid, int *status, int options, struct rusage *ru);
+#endif
+
 static inline void free_job(job_T *job);
+static pid_t wait_process(pid_t pid, int *status, int options,
+        struct rusage *ru)
+    __attribute__((nonnull));
+static void set_process_status(job_T *job, process_T *pr, int status,
+        const struct rusage *ru)
+    __attribute__((nonnull));
+#if HAVE_PIDFD_OPEN
+static bool other_job_is_running(const job_T *job)
+    __attribute__((nonnull,pure));
+static int wait_for_job_with_pidfds(
+        job_T *job, bool interruptible, bool return_on_trap)
+    __attribute__((nonnull));
+#endif
 static void trim_joblist(void);
 static void set_current_jobnumber(size_t jobnumber);
 static size_t find_next_job(size_t numlimit);
 static void apply_curstop(void);
 static int calc_status(int status)
     __attribute__((const));
+static inline void add_timeval(struct timeval *sum, const struct timeval *t)
+    __attribute__((nonnull));
+static int print_rusage(FILE *f, const struct rusage *ru)
+    __attribute__((nonnull));
 static inline int calc_status_of_process(const process_T *p)
     __attribute__((nonnull,pure));
-static wchar_t *get_job_name(const job_T *job)
+static wchar_t *get_process_name(process_T *p)
+    __attribute__((nonnull));
+static wchar_t *get_job_name(job_T *job)
     __attribute__((nonnull,warn_unused_result));
 static char *get_process_status_string(const process_T *p, bool *needfree)
     __attribute__((nonnull,malloc,warn_unused_result));
 static char *get_job_status_string(const job_T *job, bool *needfree)
     __attribute__((nonnull,malloc,warn_unused_result));
-static int print_job_status(size_t jobnumber,
-        bool changedonly, bool verbose, bool remove_done, FILE *f)
+static int print_job_status(size_t jobnumber, bool changedonly,
+        bool verbose, bool rusage, bool remove_done, FILE *f)
+    __attribute__((nonnull));
+static int print_process_rusage(const process_T *p, FILE *f)
     __attribute__((nonnull));
 static size_t get_jobnumber_from_name(const wchar_t *name)
-    __attribute__((nonnull,pure));
+    __attribute__((nonnull));
 static size_t get_jobnumber_from_pid(long pid)
     __attribute__((pure));
 
 static bool jobs_builtin_print_job(size_t jobnumber,
-        bool verbose, bool changedonly, bool pgidonly,
+        bool verbose, bool rusage, bool changedonly, bool pgidonly,
         bool runningonly, bool stoppedonly);
 static int continue_job(size_t jobnumber, job_T *job, bool fg)
     __attribute__((nonnull));
+static size_t get_jobnumber_from_jobspec(const wchar_t *jobspec)
+    __attribute__((nonnull));
 static int wait_for_job_by_jobspec(const wchar_t *jobspec)
     __attribute__((nonnull));
+static int wait_for_next_job(void *const *jobspecs, const wchar_t *pidvar)
+    __attribute__((nonnull(1)));
+static int finish_waited_job(size_t jobnumber);
 static bool wait_builtin_has_job(bool jobcontrol);
 
 
@@ -95,6 +134,12 @@ static plist_T joblist;
 /* number of the current/previous jobs. 0 if none. */
 static size_t current_jobnumber, previous_jobnumber;
 
+/* resource usage of the last foreground job that finished */
+struct rusage lastrusage;
+/* true if `lastrusage' was updated while the "logrusage" option was on and has
+ * not yet been logged */
+bool lastrusage_pending;
+
 /* Initializes the job list. */
 void init_job(void)
 {
@@ -114,8 +159,9 @@ void set_active_job(job_T *job)
 /* Moves the active job into the job list.
  * If the newly added job is stopped, it becomes the current job.
  * If `current' is true or there is no current job, the newly added job becomes
- * the current job if there is no stopped job. */
-void add_job(bool current)
+ * the current job if there is no stopped job.
+ * Returns the job number of the added job. */
+size_t add_job(bool current)
 {
     job_T *job = joblist.contents[ACTIVE_JOBNO];
     size_t jobnumber;
@@ -140,6 +186,7 @@ set_current:
         set_current_jobnumber(jobnumber);
     else
         set_current_jobnumber(current_jobnumber);
+    return jobnumber;
 }
 
 /* Returns the job of the specified number or NULL if not found. */
@@ -174,8 +221,10 @@ void remove_all_jobs(void)
 void free_job(job_T *job)
 {
     if (job != NULL) {
-        for (size_t i = 0; i < job->j_pcount; i++)
+        for (size_t i = 0; i < job->j_pcount; i++) {
             free(job->j_procs[i].pr_name);
+            comsfree(job->j_procs[i].pr_command);
+        }
         free(job);
     }
 }
@@ -352,6 +401,7 @@ void do_wait(void)
 {
     pid_t pid;
     int status;
+    struct rusage ru;
 #if HAVE_WCONTINUED
     static int waitpidoption = WUNTRACED | WCONTINUED | WNOHANG;
 #else
@@ -359,7 +409,7 @@ void do_wait(void)
 #endif
 
 start:
-    pid = waitpid(-1, &status, waitpidoption);
+    pid = wait_process(-1, &status, waitpidoption, &ru);
     if (pid < 0) {
         switch (errno) {
             case EINTR:
@@ -403,9 +453,34 @@ start:
     goto start;
 
 found:
+    set_process_status(job, pr, status, &ru);
+    goto start;
+}
+
+/* Waits for a child process like `waitpid' and stores the resource usage of
+ * the process in `*ru'. If `wait4' is not available, `*ru' is zeroed. */
+pid_t wait_process(pid_t pid, int *status, int options, struct rusage *ru)
+{
+#if HAVE_WAIT4
+    return wait4(pid, status, options, ru);
+#else
+    memset(ru, 0, sizeof *ru);
+    return waitpid(pid, status, options);
+#endif
+}
+
+/* Updates the status of the specified process of the specified job.
+ * `status' is the status code returned by `waitpid' and `ru' the resource
+ * usage of the process returned by `wait_process'.
+ * The status of the job is also updated accordingly. */
+void set_process_status(job_T *job, process_T *pr, int status,
+        const struct rusage *ru)
+{
     pr->pr_statuscode = status;
-    if (WIFEXITED(status) || WIFSIGNALED(status))
+    if (WIFEXITED(status) || WIFSIGNALED(status)) {
         pr->pr_status = JS_DONE;
+        pr->pr_rusage = *ru;
+    }
     if (WIFSTOPPED(status))
         pr->pr_status = JS_STOPPED;
 #ifdef HAVE_WCONTINUED
@@ -433,8 +508,6 @@ out_of_loop:
     job->j_status = anyrunning ? JS_RUNNING : anystopped ? JS_STOPPED : JS_DONE;
     if (job->j_status != oldstatus)
         job->j_statuschanged = true;
-
-    goto start;
 }
 
 /* Waits for the specified job to finish (or stop).
@@ -459,6 +532,18 @@ int wait_for_job(size_t jobnumber, bool return_on_stop,
     if (!job->j_legacy) {
         bool savenonotify = job->j_nonotify;
         job->j_nonotify = true;
+#if HAVE_PIDFD_OPEN
+        /* If other jobs are running, wait for this job's processes only
+         * rather than being woken up by SIGCHLD from every child. Stops
+         * are not reported through pidfds, so this cannot be used when
+         * `return_on_stop' is true. */
+        if (!return_on_stop && other_job_is_running(job))
+            signum = wait_for_job_with_pidfds(job, interruptible,
+                    return_on_trap);
+        if (signum > 0)
+            goto done;
+        signum = 0;
+#endif
         for (;;) {
             if (job->j_status == JS_DONE)
                 break;
@@ -468,11 +553,140 @@ int wait_for_job(size_t jobnumber, bool return_on_stop,
             if (signum != 0)
                 break;
         }
+#if HAVE_PIDFD_OPEN
+done:
+#endif
         job->j_nonotify = savenonotify;
     }
     return signum;
 }
 
+#if HAVE_PIDFD_OPEN
+
+/* Checks if any job other than the specified one is running. */
+bool other_job_is_running(const job_T *job)
+{
+    for (size_t i = 0; i < joblist.length; i++) {
+        const job_T *j = joblist.contents[i];
+        if (j != NULL && j != job && j->j_status == JS_RUNNING)
+            return true;
+    }
+    return false;
+}
+
+/* Waits for all the processes of the specified job to finish using pidfds.
+ * The processes are reaped by `waitpid' for their own process IDs as soon as
+ * their pidfds become readable, so this function is not affected by other
+ * child processes. Other children are left to `do_wait' as usual.
+ * Returns the signal number if interrupted, zero if the job has finished, or
+ * -1 if pidfds are not available, in which case the caller should wait for
+ * the job in the usual way. */
+int wait_for_job_with_pidfds(job_T *job, bool interruptible, bool return_on_trap)
+{
+    static bool unsupported = false;
+    if (unsupported)
+        return -1;
+
+    struct pollfd pfds[job->j_pcount];
+    process_T *prs[job->j_pcount];
+    size_t count = 0;
+    int result = 0;
+
+    for (size_t i = 0; i < job->j_pcount; i++) {
+        process_T *pr = &job->j_procs[i];
+        if (pr->pr_pid <= 0 || pr->pr_status == JS_DONE)
+            continue;
+
+        /* The process has not been reaped yet, so its process ID still
+         * refers to it. */
+        int fd = pidfd_open(pr->pr_pid, 0);
+        if (fd < 0) {
+            if (errno == ENOSYS)
+                unsupported = true;
+            result = -1;
+            goto done;
+        }
+        /* Make it a shell FD so that traps cannot redirect over it. */
+        fd = move_to_shellfd(fd);
+        if (fd < 0) {
+            result = -1;
+            goto done;
+        }
+        pfds[count] = (struct pollfd) { .fd = fd, .events = POLLIN, };
+        prs[count] = pr;
+        count++;
+    }
+
+    while (count > 0) {
+        result = wait_for_pidfds(pfds, count, interruptible, return_on_trap);
+        if (result != 0)
+            break;
+
+        for (size_t i = 0; i < count; ) {
+            if (pfds[i].revents == 0) {
+                i++;
+                continue;
+            }
+
+            int status;
+            struct rusage ru;
+            pid_t pid;
+            do
+                pid = wait_process(prs[i]->pr_pid, &status, WNOHANG, &ru);
+            while (pid < 0 && errno == EINTR);
+            if (pid == prs[i]->pr_pid)
+                set_process_status(job, prs[i], status, &ru);
+            else if (prs[i]->pr_status != JS_DONE)
+                /* unexpected; let the caller wait in the usual way */
+                result = -1;
+
+            remove_shellfd(pfds[i].fd);
+            xclose(pfds[i].fd);
+            count--;
+            pfds[i] = pfds[count];
+            prs[i] = prs[count];
+        }
+        if (result < 0)
+            break;
+    }
+
+done:
+    for (size_t i = 0; i < count; i++) {
+        remove_shellfd(pfds[i].fd);
+        xclose(pfds[i].fd);
+    }
+    return result;
+}
+
+#endif /* HAVE_PIDFD_OPEN */
+
+/* Waits until the number of running asynchronous jobs falls below the limit
+ * specified by the $YASH_JOB_LIMIT variable. If the variable is not set to a
+ * positive integer, there is no limit and this function returns immediately.
+ * If job control is active, this function can be canceled by SIGINT.
+ * Traps are not handled in this function.
+ * Returns true if a new job can be started, or false if interrupted. */
+bool wait_for_job_slot(void)
+{
+    const wchar_t *value = getvar(L VAR_YASH_JOB_LIMIT);
+    unsigned long limit;
+    if (value == NULL || !xwcstoul(value, 10, &limit) || limit == 0)
+        return true;
+
+    for (;;) {
+        size_t running = 0;
+        for (size_t i = 1; i < joblist.length; i++) {
+            const job_T *job = joblist.contents[i];
+            if (job != NULL && !job->j_legacy && job->j_status == JS_RUNNING)
+                running++;
+        }
+        if (running < limit)
+            return true;
+        if (wait_for_sigchld(doing_job_control_now, false) != 0)
+            return false;
+    }
+}
+
 /* Waits for the specified child process to finish (or stop).
  * `cpid' is the process ID of the child process to wait for. This must not be
  * in the job list.
@@ -501,12 +715,14 @@ wchar_t **wait_for_child(pid_t cpid, pid_t cpgid, bool return_on_stop)
     job->j_procs[0].pr_status = JS_RUNNING;
     job->j_procs[0].pr_statuscode = 0;
     job->j_procs[0].pr_name = NULL;
+    job->j_procs[0].pr_command = NULL;
     set_active_job(job);
     wait_for_job(ACTIVE_JOBNO, return_on_stop, false, false);
     if (doing_job_control_now)
         put_foreground(shell_pgid);
     laststatus = calc_status_of_job(job);
     if (job->j_status == JS_DONE) {
+        record_job_rusage(job);
         notify_signaled_job(ACTIVE_JOBNO);
         remove_job(ACTIVE_JOBNO);
         return NULL;
@@ -646,21 +862,98 @@ int calc_status_of_job(const job_T *job)
     }
 }
 
+/* Computes the total resource usage of the finished processes of the
+ * specified job and stores it in `*ru'. The maximum resident set size is that
+ * of the largest process rather than the sum. */
+void get_job_rusage(const job_T *job, struct rusage *ru)
+{
+    memset(ru, 0, sizeof *ru);
+    for (size_t i = 0; i < job->j_pcount; i++) {
+        const process_T *p = &job->j_procs[i];
+        if (p->pr_pid == 0 || p->pr_status != JS_DONE)
+            continue;
+
+        add_timeval(&ru->ru_utime, &p->pr_rusage.ru_utime);
+        add_timeval(&ru->ru_stime, &p->pr_rusage.ru_stime);
+        if (ru->ru_maxrss < p->pr_rusage.ru_maxrss)
+            ru->ru_maxrss = p->pr_rusage.ru_maxrss;
+        ru->ru_nvcsw   += p->pr_rusage.ru_nvcsw;
+        ru->ru_nivcsw  += p->pr_rusage.ru_nivcsw;
+        ru->ru_inblock += p->pr_rusage.ru_inblock;
+        ru->ru_oublock += p->pr_rusage.ru_oublock;
+    }
+}
+
+/* Adds `t' to `sum'. */
+void add_timeval(struct timeval *sum, const struct timeval *t)
+{
+    sum->tv_sec += t->tv_sec;
+    sum->tv_usec += t->tv_usec;
+    if (sum->tv_usec >= 1000000) {
+        sum->tv_usec -= 1000000;
+        sum->tv_sec++;
+    }
+}
+
+/* Saves the resource usage of the specified finished foreground job in
+ * `lastrusage', which is exposed as $YASH_RUSAGE. */
+void record_job_rusage(const job_T *job)
+{
+    get_job_rusage(job, &lastrusage);
+    lastrusage_pending = shopt_logrusage;
+    define_rusage_variable();
+}
+
+/* Prints the specified resource usage and command name to the standard error.
+ * This function is used by the "logrusage" option. */
+void log_rusage(const struct rusage *ru, const wchar_t *name)
+{
+    fputs("rusage: ", stderr);
+    print_rusage(stderr, ru);
+    fprintf(stderr, " %ls\n", name);
+}
+
+/* Prints the specified resource usage in a single line without a newline.
+ * Returns zero if successful. Returns errno if `fprintf' failed. */
+int print_rusage(FILE *f, const struct rusage *ru)
+{
+    int result = fprintf(f, "user=%jd.%06ld sys=%jd.%06ld maxrss=%ld "
+            "nvcsw=%ld nivcsw=%ld inblock=%ld oublock=%ld",
+            (intmax_t) ru->ru_utime.tv_sec, (long) ru->ru_utime.tv_usec,
+            (intmax_t) ru->ru_stime.tv_sec, (long) ru->ru_stime.tv_usec,
+            (long) ru->ru_maxrss, (long) ru->ru_nvcsw, (long) ru->ru_nivcsw,
+            (long) ru->ru_inblock, (long) ru->ru_oublock);
+    return (result >= 0) ? 0 : errno;
+}
+
+/* Returns the name of the specified process.
+ * If the name has not yet been made, it is made from `p->pr_command' now.
+ * The returned string must not be modified or freed by the caller. */
+wchar_t *get_process_name(process_T *p)
+{
+    if (p->pr_name == NULL && p->pr_command != NULL) {
+        p->pr_name = command_to_wcs(p->pr_command, false);
+        comsfree(p->pr_command);
+        p->pr_command = NULL;
+    }
+    return p->pr_name;
+}
+
 /* Returns the name of the specified job.
  * If the job has only one process, `job->j_procs[0].pr_name' is returned.
  * Otherwise, the names of all the process are concatenated and returned, which
  * must be freed by the caller. */
-wchar_t *get_job_name(const job_T *job)
+wchar_t *get_job_name(job_T *job)
 {
     if (job->j_pcount == 1)
-        return job->j_procs[0].pr_name;
+        return get_process_name(&job->j_procs[0]);
 
     xwcsbuf_T buf;
     wb_init(&buf);
     for (size_t i = 0; i < job->j_pcount; i++) {
         if (i > 0)
             wb_cat(&buf, L" | ");
-        wb_cat(&buf, job->j_procs[i].pr_name);
+        wb_cat(&buf, get_process_name(&job->j_procs[i]));
     }
     return wb_towcs(&buf);
 }
@@ -753,9 +1046,11 @@ bool any_job_status_has_changed(void)
  * flag is true.
  * If `verbose' is true, the status is printed in the process-wise format rather
  * than the usual job-wise format.
+ * If `verbose' and `rusage' are true, the resource usage of each finished
+ * process is printed in the line following the process.
  * Returns zero if successful. Returns errno if `fprintf' failed. */
-int print_job_status(size_t jobnumber,
-        bool changedonly, bool verbose, bool remove_done, FILE *f)
+int print_job_status(size_t jobnumber, bool changedonly,
+        bool verbose, bool rusage, bool remove_done, FILE *f)
 {
     int result = 0;
 
@@ -792,7 +1087,7 @@ int print_job_status(size_t jobnumber,
         char *status = get_process_status_string(
                 &job->j_procs[posixly_correct ? job->j_pcount - 1 : 0],
                 &needfree);
-        wchar_t *jobname = job->j_procs[0].pr_name;
+        wchar_t *jobname = get_process_name(&job->j_procs[0]);
 
         /* TRANSLATORS: the translated format string can be different 
          * from the original only in the number of spaces. This is required
@@ -802,11 +1097,13 @@ int print_job_status(size_t jobnumber,
         result = (result >= 0) ? 0 : errno;
         if (needfree)
             free(status);
+        if (rusage && result == 0)
+            result = print_process_rusage(&job->j_procs[0], f);
 
         for (size_t i = 1; result == 0 && i < job->j_pcount; i++) {
             pid = job->j_procs[i].pr_pid;
             status = get_process_status_string(&job->j_procs[i], &needfree);
-            jobname = job->j_procs[i].pr_name;
+            jobname = get_process_name(&job->j_procs[i]);
 
             /* TRANSLATORS: the translated format string can be different 
              * from the original only in the number of spaces. This is required
@@ -816,6 +1113,8 @@ int print_job_status(size_t jobnumber,
             result = (result >= 0) ? 0 : errno;
             if (needfree)
                 free(status);
+            if (rusage && result == 0)
+                result = print_process_rusage(&job->j_procs[i], f);
         }
     }
     job->j_statuschanged = false;
@@ -825,12 +1124,28 @@ int print_job_status(size_t jobnumber,
     return result;
 }
 
+/* Prints the resource usage of the specified process in a line indented to
+ * the status column of `print_job_status'. Nothing is printed if the process
+ * is not a finished child process.
+ * Returns zero if successful. Returns errno if `fprintf' failed. */
+int print_process_rusage(const process_T *p, FILE *f)
+{
+    if (p->pr_pid == 0 || p->pr_status != JS_DONE)
+        return 0;
+    if (fputs("            ", f) == EOF)
+        return errno;
+    int result = print_rusage(f, &p->pr_rusage);
+    if (result == 0 && fputc('\n', f) == EOF)
+        result = errno;
+    return result;
+}
+
 /* Prints the status of jobs which have been changed but not reported. */
 void print_job_status_all(void)
 {
     apply_curstop();
     for (size_t i = 1; i < joblist.length; i++)
-        print_job_status(i, true, false, false, stderr);
+        print_job_status(i, true, false, false, false, stderr);
 }
 
 /* If the shell is interactive and the specified job has been killed by a
@@ -955,7 +1270,7 @@ void generate_job_candidates(const le_compopt_T *compopt)
         return;
 
     for (size_t i = 1; i < joblist.length; i++) {
-        const job_T *job = joblist.contents[i];
+        job_T *job = joblist.contents[i];
         if (job == NULL)
             continue;
         switch (job->j_status) {
@@ -990,13 +1305,14 @@ void generate_job_candidates(const le_compopt_T *compopt)
 
 /* Options for the "jobs" built-in. */
 const struct xgetopt_T jobs_options[] = {
-    { L'l', L"verbose",      OPTARG_NONE, true,  NULL, },
-    { L'n', L"new",          OPTARG_NONE, false, NULL, },
-    { L'p', L"pgid-only",    OPTARG_NONE, true,  NULL, },
-    { L'r', L"running-only", OPTARG_NONE, false, NULL, },
-    { L's', L"stopped-only", OPTARG_NONE, false, NULL, },
+    { L'l', L"verbose",        OPTARG_NONE, true,  NULL, },
+    { L'n', L"new",            OPTARG_NONE, false, NULL, },
+    { L'p', L"pgid-only",      OPTARG_NONE, true,  NULL, },
+    { L'r', L"running-only",   OPTARG_NONE, false, NULL, },
+    { L's', L"stopped-only",   OPTARG_NONE, false, NULL, },
+    { L'u', L"resource-usage", OPTARG_NONE, false, NULL, },
 #if YASH_ENABLE_HELP
-    { L'-', L"help",         OPTARG_NONE, false, NULL, },
+    { L'-', L"help",           OPTARG_NONE, false, NULL, },
 #endif
     { L'\0', NULL, 0, false, NULL, },
 };
@@ -1007,11 +1323,12 @@ const struct xgetopt_T jobs_options[] = {
  *  -p: print the process ID only
  *  -r: print running jobs only
  *  -s: print stopped jobs only
+ *  -u: print the resource usage of finished processes (implies -l)
  * In the POSIXly correct mode, only -l and -p are available. */
 int jobs_builtin(int argc, void **argv)
 {
-    bool verbose = false, changedonly = false, pgidonly = false;
-    bool runningonly = false, stoppedonly = false;
+    bool verbose = false, rusage = false, changedonly = false;
+    bool pgidonly = false, runningonly = false, stoppedonly = false;
 
     const struct xgetopt_T *opt;
     xoptind = 0;
@@ -1022,6 +1339,7 @@ int jobs_builtin(int argc, void **argv)
             case L'p':  pgidonly    = true;  break;
             case L'r':  runningonly = true;  break;
             case L's':  stoppedonly = true;  break;
+            case L'u':  verbose = rusage = true;  break;
 #if YASH_ENABLE_HELP
             case L'-':
                 return print_builtin_help(ARGV(0));
@@ -1053,7 +1371,7 @@ int jobs_builtin(int argc, void **argv)
             } else if (jobnumber == 0 || joblist.contents[jobnumber] == NULL) {
                 xerror(0, Ngt("no such job `%ls'"), ARGV(xoptind));
             } else {
-                if (!jobs_builtin_print_job(jobnumber, verbose,
+                if (!jobs_builtin_print_job(jobnumber, verbose, rusage,
                         changedonly, pgidonly, runningonly, stoppedonly))
                     return Exit_FAILURE;
             }
@@ -1061,8 +1379,8 @@ int jobs_builtin(int argc, void **argv)
     } else {
         /* print all jobs */
         for (size_t i = 1; i < joblist.length; i++) {
-            if (!jobs_builtin_print_job(i, verbose, changedonly, pgidonly,
-                    runningonly, stoppedonly))
+            if (!jobs_builtin_print_job(i, verbose, rusage, changedonly,
+                    pgidonly, runningonly, stoppedonly))
                 return Exit_FAILURE;
         }
     }
@@ -1074,7 +1392,7 @@ int jobs_builtin(int argc, void **argv)
  * On an I/O error, an error message is printed to the standard error and false
  * is returned. */
 bool jobs_builtin_print_job(size_t jobnumber,
-        bool verbose, bool changedonly, bool pgidonly,
+        bool verbose, bool rusage, bool changedonly, bool pgidonly,
         bool runningonly, bool stoppedonly)
 {
     job_T *job = get_job(jobnumber);
@@ -1093,7 +1411,8 @@ bool jobs_builtin_print_job(size_t jobnumber,
         int result = printf("%jd\n", (intmax_t) job->j_pgid);
         err = (result >= 0) ? 0 : errno;
     } else {
-        err = print_job_status(jobnumber, changedonly, verbose, true, stdout);
+        err = print_job_status(
+                jobnumber, changedonly, verbose, rusage, true, stdout);
     }
     if (err != 0) {
         xerror(err, Ngt("cannot print to the standard output"));
@@ -1108,7 +1427,7 @@ const char jobs_help[] = Ngt(
 "print info about jobs"
 );
 const char jobs_syntax[] = Ngt(
-"\tjobs [-lnprs] [job...]\n"
+"\tjobs [-lnprsu] [job...]\n"
 );
 #endif
 
@@ -1229,6 +1548,14 @@ int continue_job(size_t jobnumber, job_T *job, bool fg)
                 break;
             case JS_DONE:
                 status = calc_status_of_job(job);
+                record_job_rusage(job);
+                if (lastrusage_pending) {
+                    wchar_t *jobname = get_job_name(job);
+                    log_rusage(&lastrusage, jobname);
+                    if (jobname != job->j_procs[0].pr_name)
+                        free(jobname);
+                    lastrusage_pending = false;
+                }
                 notify_signaled_job(jobnumber);
                 remove_job(jobnumber);
                 break;
@@ -1272,16 +1599,36 @@ const char bg_syntax[] = Ngt(
 
 #endif /* YASH_ENABLE_HELP */
 
-/* The "wait" built-in */
+/* Options for the "wait" built-in. */
+const struct xgetopt_T wait_options[] = {
+    { L'n', L"next",         OPTARG_NONE,     false, NULL, },
+    { L'p', L"pid-variable", OPTARG_REQUIRED, false, NULL, },
+#if YASH_ENABLE_HELP
+    { L'-', L"help",         OPTARG_NONE,     false, NULL, },
+#endif
+    { L'\0', NULL, 0, false, NULL, },
+};
+
+/* The "wait" built-in, which accepts the following options:
+ *  -n: wait for the next job to finish
+ *  -p var: assign the process ID of the finished job to `var' (with -n) */
 int wait_builtin(int argc, void **argv)
 {
     bool jobcontrol = doing_job_control_now;
+    bool next = false;
+    const wchar_t *pidvar = NULL;
     int status = Exit_SUCCESS;
 
     const struct xgetopt_T *opt;
     xoptind = 0;
-    while ((opt = xgetopt(argv, help_option, 0)) != NULL) {
+    while ((opt = xgetopt(argv, wait_options, 0)) != NULL) {
         switch (opt->shortopt) {
+            case L'n':
+                next = true;
+                break;
+            case L'p':
+                pidvar = xoptarg;
+                break;
 #if YASH_ENABLE_HELP
             case L'-':
                 return print_builtin_help(ARGV(0));
@@ -1291,7 +1638,18 @@ int wait_builtin(int argc, void **argv)
         }
     }
 
-    if (xoptind < argc) {
+    if (pidvar != NULL && !next) {
+        xerror(0, Ngt("the -p option must be used with the -n option"));
+        return Exit_ERROR;
+    }
+    if (pidvar != NULL && wcschr(pidvar, L'=') != NULL) {
+        xerror(0, Ngt("`%ls' is not a valid variable name"), pidvar);
+        return Exit_FAILURE;
+    }
+
+    if (next) {
+        status = wait_for_next_job(&argv[xoptind], pidvar);
+    } else if (xoptind < argc) {
         /* wait for the specified jobs */
         for (; xoptind < argc; xoptind++) {
             int jobstatus = wait_for_job_by_jobspec(ARGV(xoptind));
@@ -1318,9 +1676,10 @@ int wait_builtin(int argc, void **argv)
     return status;
 }
 
-/* Finds a job specified by the argument and waits for it.
- * Returns a negated exit status if interrupted. */
-int wait_for_job_by_jobspec(const wchar_t *jobspec)
+/* Returns the number of the job specified by the argument.
+ * Returns zero if no such job is found, or SIZE_MAX on error, in which case an
+ * error message is printed. */
+size_t get_jobnumber_from_jobspec(const wchar_t *jobspec)
 {
     size_t jobnumber;
     if (jobspec[0] == L'%') {
@@ -1329,19 +1688,31 @@ int wait_for_job_by_jobspec(const wchar_t *jobspec)
         long pid;
         if (!xwcstol(jobspec, 10, &pid) || pid < 0) {
             xerror(0, Ngt("`%ls' is not a valid job specification"), jobspec);
-            return Exit_FAILURE;
+            return SIZE_MAX;
         }
         jobnumber = get_jobnumber_from_pid(pid);
     }
     if (jobnumber >= joblist.length) {
         xerror(0, Ngt("job specification `%ls' is ambiguous"), jobspec);
-        return Exit_FAILURE;
+        return SIZE_MAX;
     }
 
     job_T *job;
     if (jobnumber == 0
             || (job = joblist.contents[jobnumber]) == NULL
             || job->j_legacy)
+        return 0;
+    return jobnumber;
+}
+
+/* Finds a job specified by the argument and waits for it.
+ * Returns a negated exit status if interrupted. */
+int wait_for_job_by_jobspec(const wchar_t *jobspec)
+{
+    size_t jobnumber = get_jobnumber_from_jobspec(jobspec);
+    if (jobnumber == SIZE_MAX)
+        return Exit_FAILURE;
+    if (jobnumber == 0)
         return Exit_NOTFOUND;
 
     int signal = wait_for_job(jobnumber,
@@ -1351,10 +1722,99 @@ int wait_for_job_by_jobspec(const wchar_t *jobspec)
         return -(signal + TERMSIGOFFSET);
     }
 
+    return finish_waited_job(jobnumber);
+}
+
+/* Waits for any of the jobs specified by `jobspecs' to finish. If `jobspecs'
+ * is empty, any job is waited for. If some of the jobs have already finished,
+ * the one with the smallest job number is chosen without waiting.
+ * If `pidvar' is non-null, the process ID of the last process of the finished
+ * job is assigned to the variable named `pidvar'.
+ * Returns the exit status of the job, Exit_NOTFOUND if there is no job to wait
+ * for, or the signal number plus TERMSIGOFFSET if interrupted. */
+int wait_for_next_job(void *const *jobspecs, const wchar_t *pidvar)
+{
+    bool jobcontrol = doing_job_control_now;
+    size_t count = plcount(jobspecs);
+    size_t *jobnumbers = xmallocn(count, sizeof *jobnumbers);
+    int status;
+
+    for (size_t i = 0; i < count; i++) {
+        jobnumbers[i] = get_jobnumber_from_jobspec(jobspecs[i]);
+        if (jobnumbers[i] == SIZE_MAX)
+            jobnumbers[i] = 0;
+    }
+
+    for (;;) {
+        size_t found = 0;
+        bool running = false;
+
+        for (size_t i = 1; found == 0 && i < joblist.length; i++) {
+            job_T *job = joblist.contents[i];
+            if (job == NULL || job->j_legacy)
+                continue;
+            if (count > 0) {
+                bool specified = false;
+                for (size_t j = 0; j < count; j++)
+                    if (jobnumbers[j] == i)
+                        specified = true;
+                if (!specified)
+                    continue;
+            }
+            switch (job->j_status) {
+                case JS_RUNNING:
+                    running = true;
+                    break;
+                case JS_STOPPED:
+                    if (jobcontrol)
+                        found = i;
+                    break;
+                case JS_DONE:
+                    found = i;
+                    break;
+            }
+        }
+
+        if (found != 0) {
+            status = Exit_SUCCESS;
+            if (pidvar != NULL) {
+                job_T *job = joblist.contents[found];
+                pid_t pid = job->j_procs[job->j_pcount - 1].pr_pid;
+                if (!set_variable(pidvar,
+                            malloc_wprintf(L"%jd", (intmax_t) pid),
+                            SCOPE_GLOBAL, false))
+                    status = Exit_FAILURE;
+            }
+            if (status == Exit_SUCCESS)
+                status = finish_waited_job(found);
+            break;
+        }
+        if (!running) {
+            status = Exit_NOTFOUND;
+            break;
+        }
+
+        int signal = wait_for_sigchld(jobcontrol, true);
+        if (signal != 0) {
+            assert(TERMSIGOFFSET >= 128);
+            status = signal + TERMSIGOFFSET;
+            break;
+        }
+    }
+
+    free(jobnumbers);
+    return status;
+}
+
+/* Reports or removes the specified job that has just been waited for.
+ * Returns the exit status of the job. */
+int finish_waited_job(size_t jobnumber)
+{
+    job_T *job = joblist.contents[jobnumber];
     int status = calc_status_of_job(job);
     if (job->j_status != JS_RUNNING) {
         if (doing_job_control_now && is_interactive_now && !posixly_correct)
-            print_job_status(jobnumber, false, false, true, stdout);
+            print_job_status(jobnumber, false, false, false, true, stdout);
         else if (job->j_status == JS_DONE)
             remove_job(jobnumber);
     }
@@ -1368,7 +1828,7 @@ bool wait_builtin_has_job(bool jobcontrol)
     for (size_t i = 1; i < joblist.length; i++) {
         job_T *job = joblist.contents[i];
         if (jobcontrol && is_interactive_now && !posixly_correct)
-            print_job_status(i, true, false, false, stdout);
+            print_job_status(i, true, false, false, false, stdout);
         if (job != NULL && (job->j_legacy || job->j_status == JS_DONE))
             remove_job(i);
     }
@@ -1388,6 +1848,7 @@ const char wait_help[] = Ngt(
 );
 const char wait_syntax[] = Ngt(
 "\twait [job or process_id...]\n"
+"\twait -n [-p variable] [job or process_id...]\n"
 );
 #endif
 
@@ -20,10 +20,13 @@
 #define YASH_JOB_H
 
 #include <stddef.h>
+#include <sys/resource.h>
 #include <sys/types.h>
 #include "xgetopt.h"
 
 
+struct command_T;
+
 /* status of job/process */
 typedef enum jobstatus_T {
     JS_RUNNING, JS_STOPPED, JS_DONE,
@@ -35,11 +38,18 @@ typedef struct process_T {
     jobstatus_T  pr_status;
     int          pr_statuscode;
     wchar_t     *pr_name;         /* process name made from command line */
+    struct command_T *pr_command; /* command to make `pr_name' from */
+    struct rusage pr_rusage;      /* resource usage of finished process */
 } process_T;
 /* If `pr_pid' is 0, the process was finished without `fork'ing from the shell.
  * In this case, `pr_status' is JS_DONE and `pr_statuscode' is the exit status.
  * If `pr_pid' is a positive number, it's the process ID. In this case,
- * `pr_statuscode' is the status code returned by `waitpid'. */
+ * `pr_statuscode' is the status code returned by `waitpid'.
+ * `pr_rusage' is valid only if `pr_pid' is positive and `pr_status' is JS_DONE.
+ * It is zero if the system does not support `wait4'.
+ * If `pr_name' is NULL and `pr_command' is non-NULL, the name has not yet been
+ * made. `pr_command' is converted into `pr_name' when the name is first needed
+ * and then freed. */
 
 /* info about a job */
 typedef struct job_T {
@@ -71,7 +81,9 @@ extern void init_job(void);
 
 extern void set_active_job(job_T *job)
     __attribute__((nonnull));
-extern void add_job(_Bool current);
+extern size_t add_job(_Bool current);
+extern job_T *get_job(size_t jobnumber)
+    __attribute__((pure));
 extern void remove_job(size_t jobnumber);
 extern void remove_job_nofitying_signal(size_t jobnumber);
 extern void remove_all_jobs(void);
@@ -84,6 +96,7 @@ extern size_t stopped_job_count(void)
 extern void do_wait(void);
 extern int wait_for_job(size_t jobnumber, _Bool return_on_stop,
         _Bool interruptible, _Bool return_on_trap);
+extern _Bool wait_for_job_slot(void);
 extern wchar_t **wait_for_child(pid_t cpid, pid_t cpgid, _Bool return_on_stop);
 extern pid_t get_job_pgid(const wchar_t *jobname)
     __attribute__((pure));
@@ -94,6 +107,16 @@ extern void ensure_foreground(void);
 extern int calc_status_of_job(const job_T *job)
     __attribute__((pure,nonnull));
 
+extern struct rusage lastrusage;
+extern _Bool lastrusage_pending;
+
+extern void get_job_rusage(const job_T *job, struct rusage *ru)
+    __attribute__((nonnull));
+extern void record_job_rusage(const job_T *job)
+    __attribute__((nonnull));
+extern void log_rusage(const struct rusage *ru, const wchar_t *name)
+    __attribute__((nonnull));
+
 extern _Bool any_job_status_has_changed(void)
     __attribute__((pure));
 extern void print_job_status_all(void);
@@ -117,6 +140,7 @@ extern int wait_builtin(int argc, void **argv)
 #if YASH_ENABLE_HELP
 extern const char wait_help[], wait_syntax[];
 #endif
+extern const struct xgetopt_T wait_options[];
 
 extern int disown_builtin(int argc, void **argv)
     __attribute__((nonnull));
@@ -22,24 +22,16 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
-#if HAVE_GETGRENT
-# include <grp.h>
-#endif
 #if HAVE_GETTEXT
 # include <libintl.h>
 #endif
-#if HAVE_GETHOSTENT
-# include <netdb.h>
-#endif
-#if HAVE_GETPWENT
-# include <pwd.h>
-#endif
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <wchar.h>
 #include <wctype.h>
 #include <sys/stat.h>
@@ -70,39 +62,6 @@ extern int wcscasecmp(const wchar_t *s1, const wchar_t *s2)
     __attribute__((nonnull));
 # endif
 #endif
-#if HAVE_GETPWENT
-# ifndef setpwent
-extern void setpwent(void);
-# endif
-# ifndef getpwent
-extern struct passwd *getpwent(void);
-# endif
-# ifndef endpwent
-extern void endpwent(void);
-# endif
-#endif
-#if HAVE_GETGRENT
-# if 0 /* avoid conflict on BSD */
-extern void setgrent(void);
-# endif
-# ifndef getgrent
-extern struct group *getgrent(void);
-# endif
-# ifndef endgrent
-extern void endgrent(void);
-# endif
-#endif
-#if HAVE_GETHOSTENT
-# if 0 /* avoid conflict on SunOS */
-extern void sethostent(int);
-# endif
-# ifndef gethostent
-extern struct hostent *gethostent(void);
-# endif
-# if 0 /* avoid conflict on SunOS */
-extern void endhostent(void);
-# endif
-#endif
 
 
 static void select_candidate(void selector(int offset), int offset)
@@ -111,6 +70,7 @@ static void select_candidate_by_offset(int offset);
 static void free_candidate(void *c)
     __attribute__((nonnull));
 static void free_context(le_context_T *ctxt);
+static bool check_cancel(void);
 static void sort_candidates(void);
 static int sort_candidates_cmp(const void *cp1, const void *cp2)
     __attribute__((nonnull));
@@ -131,6 +91,19 @@ static bool le_wmatch_patterns(const le_comppattern_T *ps, const wchar_t *s)
     __attribute__((nonnull(2)));
 static void generate_file_candidates(const le_compopt_T *compopt)
     __attribute__((nonnull));
+static bool generate_file_candidates_from_listing(
+        const le_compopt_T *compopt, enum wglobflags_T flags)
+    __attribute__((nonnull));
+static const struct listing_T *get_listing(const char *path)
+    __attribute__((nonnull));
+static struct listing_T *read_listing(const char *path, const struct stat *st)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static void free_listing(struct listing_T *listing)
+    __attribute__((nonnull));
+static void free_listing_kv(kvpair_T kv);
+static bool is_same_directory_state(
+        const struct stat *st1, const struct stat *st2)
+    __attribute__((nonnull,pure));
 static void generate_external_command_candidates(const le_compopt_T *compopt)
     __attribute__((nonnull));
 static void generate_keyword_candidates(const le_compopt_T *compopt)
@@ -141,6 +114,11 @@ static void generate_group_candidates(const le_compopt_T *compopt)
     __attribute__((nonnull));
 static void generate_host_candidates(const le_compopt_T *compopt)
     __attribute__((nonnull));
+static void generate_nss_candidates(
+        le_candtype_T type, nssdb_T db, const le_compopt_T *compopt)
+    __attribute__((nonnull));
+static char *get_pattern_literal_prefix(const wchar_t *pattern)
+    __attribute__((nonnull,malloc,warn_unused_result));
 static void generate_candidates_from_words(
         le_candtype_T type, void *const *words, const wchar_t *description,
         const le_compopt_T *compopt)
@@ -173,6 +151,10 @@ size_t le_selected_candidate_index;
  * The value is ((size_t) -1) when not computed. */
 static size_t common_prefix_length;
 
+/* True if the current candidate generation has been cancelled because the
+ * user typed something. */
+static bool completion_cancelled;
+
 
 /* Performs command line completion.
  * Existing candidates are deleted, if any, and candidates are computed from
@@ -204,12 +186,20 @@ void le_complete(le_compresult_T lecr)
     if (le_state_is_compdebug)
         print_context_info(ctxt);
 
+    completion_cancelled = false;
     execute_completion_function();
-    sort_candidates();
-    le_compdebug("total of %zu candidate(s)", le_candidates.length);
+    if (completion_cancelled) {
+        /* Discard the candidates and leave the input that cancelled the
+         * completion to be processed as usual. */
+        reset_interrupted();
+        le_complete_cleanup();
+    } else {
+        sort_candidates();
+        le_compdebug("total of %zu candidate(s)", le_candidates.length);
 
-    /* display the results */
-    lecr();
+        /* display the results */
+        lecr();
+    }
 
     if (le_state_is_compdebug) {
         le_compdebug("completion end");
@@ -414,51 +404,109 @@ void free_context(le_context_T *ctxt)
     }
 }
 
-/* Sorts the candidates in the candidate list and removes duplicates. */
+/* Checks if the user has typed anything since candidate generation started.
+ * If so, sets the `completion_cancelled' flag and the interrupt flag so that
+ * the running completion function, if any, is aborted.
+ * To keep the cost low, the terminal is polled only once in every
+ * `CANCEL_CHECK_INTERVAL' calls. The terminal is not polled at all in the
+ * completion debugging mode.
+ * Returns true iff candidate generation has been cancelled or interrupted. */
+bool check_cancel(void)
+{
+#ifndef CANCEL_CHECK_INTERVAL
+#define CANCEL_CHECK_INTERVAL 32
+#endif
+
+    static unsigned count = 0;
+
+    if (!completion_cancelled && !le_state_is_compdebug
+            && ++count % CANCEL_CHECK_INTERVAL == 0
+            && wait_for_input(STDIN_FILENO, false, 0) == W_READY) {
+        le_compdebug("completion cancelled by input");
+        completion_cancelled = true;
+        set_interrupted();
+    }
+    return completion_cancelled || is_interrupted();
+}
+
+/* A sort key of a candidate used in `sort_candidates'. */
+struct candkey_T {
+    le_candidate_T *cand;
+    size_t hyphens;   /* number of leading hyphens in the value */
+    wchar_t *folded;  /* lowercased value without the leading hyphens */
+    wchar_t *collkey; /* collation key of the value without the hyphens */
+};
+
+/* Sorts the candidates in the candidate list and removes duplicates.
+ * Candidates that start with hyphens are sorted in a special order so that
+ * short options come before long options. Such candidates are sorted case-
+ * insensitively. Other candidates are sorted in the collation order.
+ * To avoid calling `wcscoll' for every comparison, a sort key is computed for
+ * each candidate in advance. */
 void sort_candidates(void)
 {
-    qsort(le_candidates.contents,
-            le_candidates.length, sizeof *le_candidates.contents,
-            sort_candidates_cmp);
-
-    if (le_candidates.length >= 2) {
-        for (size_t i = le_candidates.length - 1; i > 0; i--) {
-            le_candidate_T *cand1 = le_candidates.contents[i];
-            le_candidate_T *cand2 = le_candidates.contents[i - 1];
-            // XXX case-sensitive
-            if (wcscoll(cand1->origvalue, cand2->origvalue) == 0) {
-                free_candidate(cand1);
-                pl_remove(&le_candidates, i, 1);
-            }
+    /* remove duplicates */
+    hashtable_T seen;
+    ht_initwithcapacity(&seen, hashwcs, htwcscmp, le_candidates.length);
+    size_t count = 0;
+    for (size_t i = 0; i < le_candidates.length; i++) {
+        le_candidate_T *cand = le_candidates.contents[i];
+        // XXX case-sensitive
+        if (ht_get(&seen, cand->origvalue).key != NULL) {
+            free_candidate(cand);
+        } else {
+            ht_set(&seen, cand->origvalue, NULL);
+            le_candidates.contents[count++] = cand;
         }
     }
+    ht_destroy(&seen);
+    pl_truncate(&le_candidates, count);
+
+    if (count < 2)
+        return;
+
+    /* sort */
+    bool codepoint = collation_is_codepoint_order();
+    struct candkey_T *keys = xmallocn(count, sizeof *keys);
+    for (size_t i = 0; i < count; i++) {
+        le_candidate_T *cand = le_candidates.contents[i];
+        const wchar_t *v = cand->origvalue;
+        size_t hyphens = wcsspn(v, L"-");
+        keys[i].cand = cand;
+        keys[i].hyphens = hyphens;
+        keys[i].folded = NULL;
+#if HAVE_WCSCASECMP
+        if (hyphens > 0) {
+            keys[i].folded = xwcsdup(&v[hyphens]);
+            for (wchar_t *f = keys[i].folded; *f != L'\0'; f++)
+                *f = towlower(*f);
+        }
+#endif
+        keys[i].collkey = codepoint ?
+                (wchar_t *) &v[hyphens] : malloc_wcsxfrm(&v[hyphens]);
+    }
+    qsort(keys, count, sizeof *keys, sort_candidates_cmp);
+    for (size_t i = 0; i < count; i++) {
+        le_candidates.contents[i] = keys[i].cand;
+        free(keys[i].folded);
+        if (!codepoint)
+            free(keys[i].collkey);
+    }
+    free(keys);
 }
 
 int sort_candidates_cmp(const void *cp1, const void *cp2)
 {
-    const le_candidate_T *cand1 = *(const le_candidate_T **) cp1;
-    const le_candidate_T *cand2 = *(const le_candidate_T **) cp2;
-    const wchar_t *v1 = cand1->origvalue;
-    const wchar_t *v2 = cand2->origvalue;
-
-    /* Candidates that start with hyphens are sorted in a special order so that
-     * short options come before long options. Such candidates are sorted case-
-     * insensitively. */
-    if (v1[0] == L'-' || v2[0] == L'-') {
-        while (*v1 == L'-' && *v2 == L'-')
-            v1++, v2++;
-        if (*v1 == L'-')
-            return 1;
-        if (*v2 == L'-')
-            return -1;
-#if HAVE_WCSCASECMP
-        int cmp = wcscasecmp(v1, v2);
+    const struct candkey_T *k1 = cp1, *k2 = cp2;
+
+    if (k1->hyphens != k2->hyphens)
+        return (k1->hyphens < k2->hyphens) ? -1 : 1;
+    if (k1->folded != NULL && k2->folded != NULL) {
+        int cmp = wcscmp(k1->folded, k2->folded);
         if (cmp != 0)
             return cmp;
-#endif
     }
-
-    return wcscoll(v1, v2);
+    return wcscmp(k1->collkey, k2->collkey);
     // XXX case-sensitive
 }
 
@@ -738,6 +786,13 @@ void le_new_candidate(le_candtype_T type, wchar_t *value, wchar_t *desc,
  * built-in invocation. */
 void le_add_candidate(le_candidate_T *cand, const le_compopt_T *compopt)
 {
+    if (check_cancel()) {
+        free(cand->value);
+        free(cand->desc);
+        free(cand);
+        return;
+    }
+
     xwcsbuf_T buf;
     wb_initwith(&buf, cand->value);
 
@@ -881,6 +936,9 @@ void generate_file_candidates(const le_compopt_T *compopt)
     const le_comppattern_T *p = compopt->patterns;
     assert(p->type == CPT_ACCEPT);
 
+    if (generate_file_candidates_from_listing(compopt, flags))
+        return;
+
     /* generate candidates by wglob */
     plist_T list;
     wglob(p->pattern, flags, pl_init(&list));
@@ -889,6 +947,10 @@ void generate_file_candidates(const le_compopt_T *compopt)
     /* check pathnames in `list' and add them to the candidate list */
     for (size_t i = 0; i < list.length; i++) {
         wchar_t *name = list.contents[i];
+        if (check_cancel()) {
+            free(name);
+            continue;
+        }
         if (p != NULL) {
             const wchar_t *basename = wcsrchr(name, L'/');
             if (basename == NULL)
@@ -930,6 +992,244 @@ void generate_file_candidates(const le_compopt_T *compopt)
     pl_destroy(&list);
 }
 
+/* An entry of a directory listing. */
+typedef struct listentry_T {
+    bool is_executable;
+    mode_t mode;
+    nlink_t nlink;
+    off_t size;
+    char name[];
+} listentry_T;
+
+/* A listing of a directory, which contains the names and attributes of all the
+ * files in the directory. */
+typedef struct listing_T {
+    struct stat st;    /* status of the directory when it was listed */
+    plist_T entries;   /* list of pointers to `listentry_T's */
+    char path[];
+} listing_T;
+
+/* A hashtable from directory pathnames to `listing_T's.
+ * The keys are pointers to the `path' member of the values.
+ * Listings are reused while the directory is unchanged so that completing
+ * the same directory again (with a longer prefix, for example) does not read
+ * the directory and check each file again. As the attributes of a file may
+ * change without modifying the directory, the listings are discarded when
+ * line-editing finishes.
+ * The capacity of the hashtable is zero when it is not initialized. */
+static hashtable_T listings;
+
+/* Generates filename candidates from the listing of the directory to complete.
+ * This function handles the common case where the pattern has no matching
+ * characters but in the last pathname component, in which only one directory
+ * needs listing. Returns false without generating any candidates if the
+ * pattern is not of that kind; the caller should fall back on `wglob' then. */
+bool generate_file_candidates_from_listing(
+        const le_compopt_T *compopt, enum wglobflags_T flags)
+{
+    const le_comppattern_T *p = compopt->patterns;
+    const wchar_t *basename = wcsrchr(p->pattern, L'/');
+    basename = (basename != NULL) ? basename + 1 : p->pattern;
+    if (!is_matching_pattern(basename))
+        return false;
+
+    wchar_t *wdirname = xwcsndup(p->pattern, basename - p->pattern);
+    if (is_matching_pattern(wdirname)) {
+        free(wdirname);
+        return false;
+    }
+    wchar_t *escaped = wdirname;
+    wdirname = unescape(escaped);
+    free(escaped);
+    char *dirname = malloc_wcstombs(wdirname);
+    if (dirname == NULL) {
+        free(wdirname);
+        return false;
+    }
+
+    xfnmflags_T xflags = XFNM_HEADONLY | XFNM_TAILONLY;
+    if (!(flags & WGLB_PERIOD))
+        xflags |= XFNM_PERIOD;
+    xfnmatch_T *xfnm = xfnm_compile(basename, xflags);
+    const listing_T *listing = (xfnm == NULL) ? NULL : get_listing(dirname);
+
+    if (listing != NULL) {
+        size_t dirnamelen = wcslen(wdirname);
+        p = p->next;
+        for (size_t i = 0; i < listing->entries.length; i++) {
+            const listentry_T *e = listing->entries.contents[i];
+            if (check_cancel())
+                break;
+            if (xfnm_match(xfnm, e->name) != 0)
+                continue;
+            if (!(compopt->type & CGT_FILE)
+                    && !((compopt->type & CGT_DIRECTORY) && S_ISDIR(e->mode))
+                    && !((compopt->type & CGT_EXECUTABLE) && e->is_executable))
+                continue;
+
+            xwcsbuf_T name;
+            wb_init(&name);
+            wb_ncat_force(&name, wdirname, dirnamelen);
+            if (wb_mbscat(&name, e->name) != NULL
+                    || (p != NULL && !le_wmatch_patterns(
+                            p, &name.contents[dirnamelen]))) {
+                wb_destroy(&name);
+                continue;
+            }
+
+            le_candidate_T *cand = xmalloc(sizeof *cand);
+            cand->type = CT_FILE;
+            cand->value = wb_towcs(&name);
+            cand->rawvalue.raw = NULL;
+            cand->rawvalue.width = 0;
+            cand->desc = NULL;
+            cand->rawdesc.raw = NULL;
+            cand->rawdesc.width = 0;
+            cand->appendage.filestat.is_executable = e->is_executable;
+            cand->appendage.filestat.mode = e->mode;
+            cand->appendage.filestat.nlink = e->nlink;
+            cand->appendage.filestat.size = e->size;
+            le_add_candidate(cand, compopt);
+        }
+    }
+
+    if (xfnm != NULL)
+        xfnm_free(xfnm);
+    free(dirname);
+    free(wdirname);
+    return true;
+}
+
+/* Returns the listing of the specified directory.
+ * If the directory has been listed and not modified since then, the cached
+ * listing is returned. Otherwise, the directory is read and the new listing is
+ * cached. An empty `path' denotes the current directory.
+ * Returns NULL if the directory cannot be read or completion is cancelled. */
+const listing_T *get_listing(const char *path)
+{
+    struct stat st;
+    if (stat((path[0] == '\0') ? "." : path, &st) < 0 || !S_ISDIR(st.st_mode))
+        return NULL;
+
+    if (listings.capacity == 0)
+        ht_init(&listings, hashstr, htstrcmp);
+
+    listing_T *listing = ht_get(&listings, path).value;
+    if (listing != NULL) {
+        if (is_same_directory_state(&listing->st, &st)) {
+            le_compdebug("reusing the listing of directory \"%s\"", path);
+            return listing;
+        }
+        ht_remove(&listings, path);
+        free_listing(listing);
+    }
+
+    listing = read_listing(path, &st);
+    if (listing != NULL)
+        ht_set(&listings, listing->path, listing);
+    return listing;
+}
+
+/* Reads the specified directory and returns a new listing of it.
+ * `st' must be the result of `stat'ing the directory.
+ * Returns NULL if the directory cannot be opened or completion is cancelled. */
+listing_T *read_listing(const char *path, const struct stat *st)
+{
+    DIR *dir = opendir((path[0] == '\0') ? "." : path);
+    if (dir == NULL)
+        return NULL;
+
+    listing_T *listing = xmallocs(sizeof *listing,
+            add(strlen(path), 1), sizeof *listing->path);
+    listing->st = *st;
+    pl_init(&listing->entries);
+    strcpy(listing->path, path);
+
+    /* `filepath' is used to check if files are executable and, if `fstatat' is
+     * not available, to `stat' files. */
+    xstrbuf_T filepath;
+    sb_init(&filepath);
+    sb_cat(&filepath, path);
+    if (filepath.length > 0 && filepath.contents[filepath.length - 1] != '/')
+        sb_ccat(&filepath, '/');
+    size_t dirlen = filepath.length;
+
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (check_cancel()) {
+            free_listing(listing);
+            listing = NULL;
+            break;
+        }
+
+        struct stat fst;
+        sb_truncate(&filepath, dirlen);
+        sb_cat(&filepath, de->d_name);
+#if HAVE_FSTATAT
+        if (fstatat(dirfd(dir), de->d_name, &fst, 0) < 0 &&
+                fstatat(dirfd(dir), de->d_name, &fst, AT_SYMLINK_NOFOLLOW) < 0)
+            continue;
+#else
+        if (stat(filepath.contents, &fst) < 0 &&
+                lstat(filepath.contents, &fst) < 0)
+            continue;
+#endif
+
+        listentry_T *e = xmallocs(sizeof *e,
+                add(strlen(de->d_name), 1), sizeof *e->name);
+        e->is_executable = S_ISREG(fst.st_mode)
+            && (fst.st_mode & (S_IXUSR | S_IXGRP | S_IXOTH))
+            && is_executable(filepath.contents);
+        e->mode = fst.st_mode;
+        e->nlink = fst.st_nlink;
+        e->size = fst.st_size;
+        strcpy(e->name, de->d_name);
+        pl_add(&listing->entries, e);
+    }
+
+    sb_destroy(&filepath);
+    closedir(dir);
+    return listing;
+}
+
+/* Frees the specified listing. */
+void free_listing(listing_T *listing)
+{
+    plfree(pl_toary(&listing->entries), free);
+    free(listing);
+}
+
+/* Frees the listing that is the value of the specified hashtable entry. */
+void free_listing_kv(kvpair_T kv)
+{
+    free_listing(kv.value);
+}
+
+/* Checks if the two `stat' results refer to the same directory with the same
+ * modification time. */
+bool is_same_directory_state(const struct stat *st1, const struct stat *st2)
+{
+    return stat_result_same_file(st1, st2)
+        && st1->st_mtime == st2->st_mtime
+#if HAVE_ST_MTIM
+        && st1->st_mtim.tv_nsec == st2->st_mtim.tv_nsec
+#elif HAVE_ST_MTIMESPEC
+        && st1->st_mtimespec.tv_nsec == st2->st_mtimespec.tv_nsec
+#elif HAVE_ST_MTIMENSEC
+        && st1->st_mtimensec == st2->st_mtimensec
+#endif
+        ;
+}
+
+/* Discards all the cached directory listings. */
+void le_complete_forget_listings(void)
+{
+    if (listings.capacity > 0) {
+        ht_destroy(ht_clear(&listings, free_listing_kv));
+        listings.capacity = 0;
+    }
+}
+
 /* Generates candidates that are the names of external commands matching the
  * pattern.
  * If CGT_EXTCOMMAND is not in `type', this function does nothing. */
@@ -960,6 +1260,8 @@ void generate_external_command_candidates(const le_compopt_T *compopt)
             sb_ccat(&path, '/');
         dirpathlen = path.length;
         while ((de = readdir(dir)) != NULL) {
+            if (check_cancel())
+                break;
             if (!le_match_comppatterns(compopt, de->d_name))
                 continue;
             sb_cat(&path, de->d_name);
@@ -1004,20 +1306,7 @@ void generate_logname_candidates(const le_compopt_T *compopt)
     le_compdebug("adding user name candidates");
 
 #if HAVE_GETPWENT
-    if (!le_compile_cpatterns(compopt))
-        return;
-
-    struct passwd *pwd;
-    setpwent();
-    while ((pwd = getpwent()) != NULL)
-        if (le_match_comppatterns(compopt, pwd->pw_name))
-            le_new_candidate(CT_LOGNAME, malloc_mbstowcs(pwd->pw_name),
-# if HAVE_PW_GECOS
-                    (pwd->pw_gecos != NULL) ? malloc_mbstowcs(pwd->pw_gecos) :
-# endif
-                    NULL,
-                    compopt);
-    endpwent();
+    generate_nss_candidates(CT_LOGNAME, NSSDB_PASSWD, compopt);
 #else
     le_compdebug("  getpwent not supported on this system");
 #endif
@@ -1032,16 +1321,7 @@ void generate_group_candidates(const le_compopt_T *compopt)
     le_compdebug("adding group name candidates");
 
 #if HAVE_GETGRENT
-    if (!le_compile_cpatterns(compopt))
-        return;
-
-    struct group *grp;
-    setgrent();
-    while ((grp = getgrent()) != NULL)
-        if (le_match_comppatterns(compopt, grp->gr_name))
-            le_new_candidate(
-                    CT_GRP, malloc_mbstowcs(grp->gr_name), NULL, compopt);
-    endgrent();
+    generate_nss_candidates(CT_GRP, NSSDB_GROUP, compopt);
 #else
     le_compdebug("  getgrent not supported on this system");
 #endif
@@ -1056,25 +1336,60 @@ void generate_host_candidates(const le_compopt_T *compopt)
     le_compdebug("adding host name candidates");
 
 #if HAVE_GETHOSTENT
+    generate_nss_candidates(CT_HOSTNAME, NSSDB_HOSTS, compopt);
+#else
+    le_compdebug("  gethostent not supported on this system");
+#endif
+}
+
+/* Generates candidates from the entries of the specified user, group, or host
+ * database that match the pattern.
+ * The entries are taken from the snapshot of the database (see
+ * `get_nss_entries'), narrowed down by the literal prefix of the pattern. */
+void generate_nss_candidates(
+        le_candtype_T type, nssdb_T db, const le_compopt_T *compopt)
+{
     if (!le_compile_cpatterns(compopt))
         return;
 
-    struct hostent *host;
-    sethostent(true);
-    while ((host = gethostent()) != NULL) {
-        if (le_match_comppatterns(compopt, host->h_name))
-            le_new_candidate(
-                    CT_HOSTNAME, malloc_mbstowcs(host->h_name), NULL, compopt);
-        if (host->h_aliases != NULL)
-            for (char *const *a = host->h_aliases; *a != NULL; a++)
-                if (le_match_comppatterns(compopt, *a))
-                    le_new_candidate(
-                            CT_HOSTNAME, malloc_mbstowcs(*a), NULL, compopt);
+    char *prefix = get_pattern_literal_prefix(compopt->patterns->pattern);
+    size_t count;
+    const nssentry_T *entries =
+        get_nss_entries(db, prefix, &count, check_cancel);
+    free(prefix);
+
+    for (size_t i = 0; i < count; i++) {
+        if (check_cancel())
+            break;
+        if (le_match_comppatterns(compopt, entries[i].name))
+            le_new_candidate(type, malloc_mbstowcs(entries[i].name),
+                    (entries[i].info != NULL) ?
+                        malloc_mbstowcs(entries[i].info) : NULL,
+                    compopt);
     }
-    endhostent();
-#else
-    le_compdebug("  gethostent not supported on this system");
-#endif
+}
+
+/* Returns the literal part at the beginning of the specified pattern, which is
+ * a prefix of any string that matches the pattern.
+ * The result is a newly malloced multibyte string. */
+char *get_pattern_literal_prefix(const wchar_t *pattern)
+{
+    xwcsbuf_T buf;
+    wb_init(&buf);
+    for (; *pattern != L'\0'; pattern++) {
+        if (*pattern == L'*' || *pattern == L'?' || *pattern == L'[')
+            break;
+        if (*pattern == L'\\') {
+            pattern++;
+            if (*pattern == L'\0')
+                break;
+        }
+        wb_wccat(&buf, *pattern);
+    }
+
+    char *result = malloc_wcstombs(buf.contents);
+    wb_destroy(&buf);
+    return (result != NULL) ? result : xstrdup("");
 }
 
 /* Generates candidates from words that match the pattern. */
@@ -195,6 +195,7 @@ extern void le_complete_select_column(int offset);
 extern void le_complete_select_page(int offset);
 extern _Bool le_complete_fix_candidate(int index);
 extern void le_complete_cleanup(void);
+extern void le_complete_forget_listings(void);
 extern void le_compdebug(const char *format, ...)
     __attribute__((nonnull,format(printf,1,2)));
 
@@ -464,6 +464,23 @@ bool cparse_for_command(void)
         skip_blanks();
     while (csubstitute_alias(0));
 
+    /* skip the -P and -k options of the parallel for loop */
+    for (;;) {
+        if (has_token(L"-k")) {
+            INDEX += 2;
+        } else if (has_token(L"-P")) {
+            INDEX += 2;
+            skip_blanks();
+            if (ctryparse_word(TT_SINGLE, CTXT_NORMAL)) {
+                empty_pwords();
+                return true;
+            }
+        } else {
+            break;
+        }
+        skip_blanks();
+    }
+
     /* parse variable name */
     wordunit_T *w = cparse_word(is_token_delimiter_char, TT_NONE, CTXT_VAR);
     if (w == NULL) {
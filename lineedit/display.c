@@ -23,11 +23,13 @@
 # include <libintl.h>
 #endif
 #include <limits.h>
+#include <locale.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <wchar.h>
 #include <wctype.h>
@@ -77,6 +79,119 @@ extern int wcwidth(wchar_t c);
 #endif
 
 
+/********** Character Width **********/
+
+static int char_width(wchar_t c);
+static void make_bmp_widths(void);
+static void make_width_ranges(void);
+static bool check_width_locale(void);
+
+/* The number of characters in the Basic Multilingual Plane. */
+#define BMP_SIZE 0x10000
+/* The largest character code point. */
+#define MAX_CODE_POINT 0x10FFFF
+
+/* The widths of the characters in the BMP, as returned by `wcwidth', packed
+ * in two bits per character. A width of -1 is stored as 3.
+ * NULL if not yet computed. */
+static unsigned char *bmp_widths = NULL;
+
+/* The widths of the characters above the BMP as runs of characters of the
+ * same width. A run starts at `first' and ends before the next run.
+ * NULL if not yet computed. */
+static struct widthrange_T {
+    wchar_t first;
+    int width;
+} *width_ranges = NULL;
+static size_t width_range_count;
+
+/* The LC_CTYPE locale for which `bmp_widths' and `width_ranges' are computed.
+ */
+static char *width_locale = NULL;
+
+/* Returns the number of columns the character occupies, like `wcwidth'.
+ * The widths are looked up in tables computed with `wcwidth' on first use. */
+int char_width(wchar_t c)
+{
+    if (0 <= c && c < BMP_SIZE) {
+        if (bmp_widths == NULL)
+            make_bmp_widths();
+        int width = (bmp_widths[c / 4] >> (c % 4 * 2)) & 3;
+        return (width == 3) ? -1 : width;
+    }
+    if (c < 0 || c > MAX_CODE_POINT)
+        return wcwidth(c);
+
+    if (width_ranges == NULL)
+        make_width_ranges();
+
+    /* binary search for the last run that starts at or before `c' */
+    size_t lo = 0, hi = width_range_count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (width_ranges[mid].first <= c)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return width_ranges[lo].width;
+}
+
+/* Computes `bmp_widths'. */
+void make_bmp_widths(void)
+{
+    bmp_widths = xmalloc(BMP_SIZE / 4);
+    memset(bmp_widths, 0, BMP_SIZE / 4);
+    for (wchar_t c = 0; c < BMP_SIZE; c++) {
+        int width = wcwidth(c);
+        if (width < 0 || width > 2)
+            width = 3;
+        bmp_widths[c / 4] |= width << (c % 4 * 2);
+    }
+}
+
+/* Computes `width_ranges'. */
+void make_width_ranges(void)
+{
+    wchar_t last = (WCHAR_MAX < MAX_CODE_POINT) ? WCHAR_MAX : MAX_CODE_POINT;
+    size_t capacity = 64;
+    width_ranges = xmallocn(capacity, sizeof *width_ranges);
+    width_range_count = 0;
+    for (wchar_t c = BMP_SIZE; ; c++) {
+        int width = wcwidth(c);
+        if (width_range_count == 0
+                || width_ranges[width_range_count - 1].width != width) {
+            if (width_range_count == capacity) {
+                capacity = mul(capacity, 2);
+                width_ranges = xreallocn(width_ranges,
+                        capacity, sizeof *width_ranges);
+            }
+            width_ranges[width_range_count].first = c;
+            width_ranges[width_range_count].width = width;
+            width_range_count++;
+        }
+        if (c == last)
+            break;
+    }
+}
+
+/* Discards the width tables if the LC_CTYPE locale has been changed since they
+ * were computed. Returns true iff the tables have been discarded. */
+bool check_width_locale(void)
+{
+    const char *locale = setlocale(LC_CTYPE, NULL);
+    if (locale == NULL)
+        locale = "";
+    if (width_locale != NULL && strcmp(width_locale, locale) == 0)
+        return false;
+
+    free(bmp_widths), bmp_widths = NULL;
+    free(width_ranges), width_ranges = NULL;
+    free(width_locale), width_locale = xstrdup(locale);
+    return true;
+}
+
+
 /********** The Print Buffer **********/
 
 static void lebuf_init_with_max(le_pos_T p, int maxcolumn);
@@ -146,7 +261,7 @@ void lebuf_putwchar_raw(wchar_t c)
  * '^'-prefixed form or the bracketed form. */
 void lebuf_putwchar(wchar_t c, bool convert_cntrl)
 {
-    int width = wcwidth(c);
+    int width = char_width(c);
     if (width > 0) {
         /* printable character */
         lebuf_update_position(width);
@@ -296,7 +411,7 @@ done:
  * Returns true for a non-printable character. */
 bool lebuf_putwchar_trunc(wchar_t c)
 {
-    int width = wcwidth(c);
+    int width = char_width(c);
     if (width <= 0)
         return true;
 
@@ -338,7 +453,13 @@ static void finish(void);
 static void clear_to_end_of_screen(void);
 static void clear_editline(void);
 static void maybe_print_promptsp(void);
+static void prepare_prompts(void);
+static void free_prompts(void);
+static bool can_reuse_prompts(void)
+    __attribute__((pure));
 static void update_editline(void);
+static bool update_editline_in_place(size_t index);
+static void reserve_editline(size_t length);
 static bool current_display_is_uptodate(size_t index)
     __attribute__((pure));
 static void check_cand_overwritten(void);
@@ -400,6 +521,9 @@ static wchar_t *current_editline = NULL;
  * If the nth character of `current_editline' is positioned at line `l', column
  * `c', then cursor_positions[n] == l * le_columns + c. */
 static int *cursor_positions = NULL;
+/* The number of elements allocated for `current_editline' and
+ * `cursor_positions'. */
+static size_t editline_capacity = 0;
 /* The current index in the edit line that divides the line into two (cf.
  * `le_main_buffer'). */
 static size_t current_length = 0;
@@ -425,6 +549,26 @@ static struct {
     size_t length;  /* number of bytes in `value' */
 } sprompt;
 
+/* The value of the main prompt where escape sequences have been processed. */
+static struct {
+    char *value;
+    size_t length;  /* number of bytes in `value' */
+    le_pos_T pos;   /* cursor position after the prompt is printed */
+} mprompt;
+
+/* The processed prompts above are reused when the display is re-activated
+ * as long as the prompt strings, the terminal, its width, and the number of
+ * jobs (which may be included in the prompts) are unchanged. The history
+ * number is also compared if the prompts may include it.
+ * `prompts_columns' is the terminal width with which the prompts were
+ * processed, or -1 if they have not been processed. */
+static int prompts_columns = -1;
+static size_t prompts_job_count;
+static unsigned prompts_history_number;
+static unsigned prompts_terminfo_serial;
+/* Copies of the prompt strings from which the prompts were processed. */
+static wchar_t *prompts_main, *prompts_right, *prompts_styler;
+
 /* The type of completion candidate pages. */
 struct candpage_T {
     size_t colindex;  /* index of the first column in this page */
@@ -465,6 +609,12 @@ static bool candoverwritten;
 void le_display_init(struct promptset_T prompt_)
 {
     prompt = prompt_;
+
+    /* The cached prompts are laid out with the character widths of the
+     * previous locale. */
+    if (check_width_locale()
+            || (prompts_columns >= 0 && !can_reuse_prompts()))
+        free_prompts();
 }
 
 /* Updates the prompt and the edit line, clears the candidate area, and leave
@@ -509,8 +659,7 @@ void finish(void)
 
     free(current_editline), current_editline = NULL;
     free(cursor_positions), cursor_positions = NULL;
-    free(rprompt.value);
-    free(sprompt.value);
+    editline_capacity = 0;
 
     le_display_flush();
     display_active = false;
@@ -587,36 +736,19 @@ void le_display_update(bool cursor)
         last_edit_line = line_max = 0;
         candhighlight = NOHIGHLIGHT, candbaseline = -1, candoverwritten = false;
 
-        /* prepare the right prompt */
-        lebuf_init((le_pos_T) { 0, 0 });
-        lebuf_print_sgr0();
-        lebuf_print_prompt(prompt.right);
-        if (lebuf.pos.line != 0) {  /* right prompt must be one line */
-            sb_clear(&lebuf.buf);
-            /* lebuf.pos.line = */ lebuf.pos.column = 0;
+        if (prompts_columns != le_columns || prompts_job_count != job_count()
+                || prompts_terminfo_serial != le_terminfo_serial) {
+            free_prompts();
+            prepare_prompts();
         }
-        rprompt.value = lebuf.buf.contents;
-        rprompt.length = lebuf.buf.length;
-        rprompt.width = lebuf.pos.column;
         rprompt_line = -1;
-
-        /* prepare the styler prompt */
-        lebuf_init((le_pos_T) { 0, 0 });
-        lebuf_print_sgr0();
-        lebuf_print_prompt(prompt.styler);
-        if (lebuf.pos.line != 0 || lebuf.pos.column != 0) {
-            /* styler prompt must have no width */
-            sb_clear(&lebuf.buf);
-            /* lebuf.pos.line = lebuf.pos.column = 0; */
-        }
-        sprompt.value = lebuf.buf.contents;
-        sprompt.length = lebuf.buf.length;
         styler_active = false;
 
         /* print main prompt */
         lebuf_init((le_pos_T) { 0, 0 });
         maybe_print_promptsp();
-        lebuf_print_prompt(prompt.main);
+        sb_ncat_force(&lebuf.buf, mprompt.value, mprompt.length);
+        lebuf.pos = mprompt.pos;
         fillip_cursor();
         editbasepos = lebuf.pos;
     }
@@ -644,6 +776,86 @@ void le_display_update(bool cursor)
     }
 }
 
+/* Processes escape sequences in the main, right, and styler prompts and saves
+ * the results in `mprompt', `rprompt', and `sprompt'. */
+void prepare_prompts(void)
+{
+    /* prepare the right prompt */
+    lebuf_init((le_pos_T) { 0, 0 });
+    lebuf_print_sgr0();
+    lebuf_print_prompt(prompt.right);
+    if (lebuf.pos.line != 0) {  /* right prompt must be one line */
+        sb_clear(&lebuf.buf);
+        /* lebuf.pos.line = */ lebuf.pos.column = 0;
+    }
+    rprompt.value = lebuf.buf.contents;
+    rprompt.length = lebuf.buf.length;
+    rprompt.width = lebuf.pos.column;
+
+    /* prepare the styler prompt */
+    lebuf_init((le_pos_T) { 0, 0 });
+    lebuf_print_sgr0();
+    lebuf_print_prompt(prompt.styler);
+    if (lebuf.pos.line != 0 || lebuf.pos.column != 0) {
+        /* styler prompt must have no width */
+        sb_clear(&lebuf.buf);
+        /* lebuf.pos.line = lebuf.pos.column = 0; */
+    }
+    sprompt.value = lebuf.buf.contents;
+    sprompt.length = lebuf.buf.length;
+
+    /* prepare the main prompt */
+    lebuf_init((le_pos_T) { 0, 0 });
+    lebuf_print_prompt(prompt.main);
+    mprompt.value = lebuf.buf.contents;
+    mprompt.length = lebuf.buf.length;
+    mprompt.pos = lebuf.pos;
+
+    prompts_columns = le_columns;
+    prompts_job_count = job_count();
+    prompts_history_number = next_history_number();
+    prompts_terminfo_serial = le_terminfo_serial;
+    prompts_main = xwcsdup(prompt.main);
+    prompts_right = xwcsdup(prompt.right);
+    prompts_styler = xwcsdup(prompt.styler);
+}
+
+/* Frees the prompts prepared by `prepare_prompts'. */
+void free_prompts(void)
+{
+    if (prompts_columns >= 0) {
+        free(rprompt.value);
+        free(sprompt.value);
+        free(mprompt.value);
+        free(prompts_main);
+        free(prompts_right);
+        free(prompts_styler);
+        prompts_columns = -1;
+    }
+}
+
+/* Checks if the prompts prepared by `prepare_prompts' in a previous
+ * line-editing session can be used for the current prompt strings.
+ * The terminal width and the number of jobs are checked when the display is
+ * activated. */
+bool can_reuse_prompts(void)
+{
+    assert(prompts_columns >= 0);
+
+    if (wcscmp(prompts_main, prompt.main) != 0
+            || wcscmp(prompts_right, prompt.right) != 0
+            || wcscmp(prompts_styler, prompt.styler) != 0)
+        return false;
+
+    if (prompts_history_number != next_history_number()
+            && (wcsstr(prompt.main, L"\\!") != NULL
+                || wcsstr(prompt.right, L"\\!") != NULL
+                || wcsstr(prompt.styler, L"\\!") != NULL))
+        return false;
+
+    return true;
+}
+
 /* Prints a dummy string that moves the cursor to the first column of the next
  * line if the cursor is not at the first column.
  * This function does nothing if the "le-promptsp" option is not set. */
@@ -681,6 +893,9 @@ void update_editline(void)
                 && le_main_buffer.contents[index] == L'\0')
             return;
 
+        if (update_editline_in_place(index))
+            return;
+
         go_to_index(index);
         if (current_editline[index] != L'\0')
             clear_editline();
@@ -692,12 +907,7 @@ void update_editline(void)
 
     update_styler();
 
-    // No need to check for overflow in `le_main_buffer.length + 1' here. Should
-    // overflow occur, the buffer would not have been allocated successfully.
-    current_editline = xreallocn(current_editline,
-            le_main_buffer.length + 1, sizeof *current_editline);
-    cursor_positions = xreallocn(cursor_positions,
-            le_main_buffer.length + 1, sizeof *cursor_positions);
+    reserve_editline(le_main_buffer.length);
     for (;;) {
         wchar_t c = le_main_buffer.contents[index];
         current_editline[index] = c;
@@ -734,6 +944,107 @@ void update_editline(void)
     check_cand_overwritten();
 }
 
+/* Updates the edit line on the screen by inserting or deleting characters in
+ * place using the "ich" and "dch" capabilities, without reprinting the rest of
+ * the line.
+ * This is possible only if the edit line has been changed by a single insertion
+ * or deletion at `index', the characters after it remain on the same screen
+ * line, and the line does not contain the right prompt or the predicted part of
+ * the edit line.
+ * Returns true iff the screen has been updated. */
+bool update_editline_in_place(size_t index)
+{
+    size_t oldlength = index + wcslen(&current_editline[index]);
+    size_t newlength = le_main_buffer.length;
+    if (current_length < oldlength || le_main_length < newlength)
+        return false;  /* the line contains a prediction */
+
+    size_t inserted, deleted;
+    if (newlength > oldlength)
+        inserted = newlength - oldlength, deleted = 0;
+    else
+        inserted = 0, deleted = oldlength - newlength;
+    if (index + deleted >= oldlength)
+        return false;  /* nothing to preserve after the change */
+    if (wmemcmp(&current_editline[index + deleted],
+                &le_main_buffer.contents[index + inserted],
+                oldlength - index - deleted) != 0)
+        return false;
+
+    int line = cursor_positions[index] / lebuf.maxcolumn;
+    if (line == rprompt_line
+            || cursor_positions[oldlength] / lebuf.maxcolumn != line)
+        return false;
+
+    int shift;
+    if (inserted > 0) {
+        shift = 0;
+        for (size_t i = index; i < index + inserted; i++) {
+            /* non-printable characters are printed in a converted form */
+            int width = char_width(le_main_buffer.contents[i]);
+            if (width <= 0)
+                return false;
+            shift += width;
+        }
+        if (cursor_positions[oldlength] % lebuf.maxcolumn + shift
+                >= lebuf.maxcolumn)
+            return false;
+
+        go_to_index(index);
+        if (!lebuf_print_ich(shift))
+            return false;
+    } else {
+        shift = cursor_positions[index] - cursor_positions[index + deleted];
+        if (shift >= 0)
+            return false;  /* only zero-width characters were deleted */
+
+        go_to_index(index);
+        if (!lebuf_print_dch(-shift))
+            return false;
+    }
+
+    reserve_editline(newlength);
+    size_t movecount = oldlength - index - deleted + 1;
+    wmemmove(&current_editline[index + inserted],
+            &current_editline[index + deleted], movecount);
+    memmove(&cursor_positions[index + inserted],
+            &cursor_positions[index + deleted],
+            movecount * sizeof *cursor_positions);
+    for (size_t i = index + inserted; i <= newlength; i++)
+        cursor_positions[i] += shift;
+
+    update_styler();
+    for (size_t i = index; i < index + inserted; i++) {
+        wchar_t c = le_main_buffer.contents[i];
+        current_editline[i] = c;
+        cursor_positions[i]
+            = lebuf.pos.line * lebuf.maxcolumn + lebuf.pos.column;
+        lebuf_putwchar(c, true);
+    }
+
+    current_length = le_main_length;
+    return true;
+}
+
+/* Makes sure that `current_editline' and `cursor_positions' have room for at
+ * least `length + 1' elements. */
+void reserve_editline(size_t length)
+{
+    if (length < editline_capacity)
+        return;
+
+    // No need to check for overflow in `length + 1' here. Should overflow
+    // occur, the main buffer would not have been allocated successfully.
+    size_t capacity = editline_capacity * 2;
+    if (capacity <= length)
+        capacity = length + 1;
+    current_editline = xreallocn(current_editline,
+            capacity, sizeof *current_editline);
+    cursor_positions = xreallocn(cursor_positions,
+            capacity, sizeof *cursor_positions);
+    editline_capacity = capacity;
+}
+
 bool current_display_is_uptodate(size_t index)
 {
     if (current_editline[index] != le_main_buffer.contents[index])
@@ -815,6 +1126,7 @@ void print_search(void)
 
     free(current_editline), current_editline = NULL;
     free(cursor_positions), cursor_positions = NULL;
+    editline_capacity = 0;
 
     go_to(editbasepos);
     clear_editline();
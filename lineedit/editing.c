@@ -101,6 +101,19 @@ static struct {
     wchar_t *value;
 } last_search;
 
+/* The parameters and the result of the last search performed by
+ * `perform_search'. `literal' is NULL if the last search was not a literal
+ * search. This is reset for each line-editing session; the history is not
+ * modified during a session. */
+static struct {
+    wchar_t *literal;
+    const histlink_T *start;
+    enum le_search_direction_T direction;
+    enum le_search_type_T type;
+    xfnmflags_T flags;
+    const histlink_T *result;
+} last_performed_search;
+
 /* The last executed command and the currently executing command. */
 static struct le_command_T last_command, current_command;
 
@@ -205,7 +218,11 @@ static bool next_reset_completion;
 /* Probability distribution tree for command prediction. */
 static trie_T *prediction_tree = NULL;
 
+/* The string being inserted by `le_insert_pasted'. */
+static const wchar_t *pasted_string;
 
+
+static void insert_pasted(wchar_t c);
 static void reset_state(void);
 static void reset_count(void);
 static int get_count(int default_value)
@@ -324,6 +341,8 @@ static void go_to_history(const histlink_T *l, enum le_search_type_T curpos)
 static bool need_update_last_search_value(void)
     __attribute__((pure));
 static void update_search(void);
+static bool is_literal_vi_search_pattern(const wchar_t *pattern)
+    __attribute__((nonnull,pure));
 static void perform_search(const wchar_t *pattern,
         enum le_search_direction_T dir, enum le_search_type_T type)
     __attribute__((nonnull));
@@ -382,9 +401,12 @@ wchar_t *le_editing_finalize(void)
     plfree(pl_toary(&undo_history), free);
 
     le_complete_cleanup();
+    le_complete_forget_listings();
 
     end_using_history();
     free(main_history_value);
+    free(last_performed_search.literal);
+    last_performed_search.literal = NULL;
 
     clear_prediction();
     trie_destroy(prediction_tree), prediction_tree = NULL;
@@ -426,6 +448,41 @@ void le_invoke_command(le_command_func_T *cmd, wchar_t arg)
             le_main_index--;
 }
 
+/* Inserts the specified string that was pasted in the bracketed paste mode.
+ * If the default command of the current mode is `cmd_self_insert', the whole
+ * string is inserted at once as a single command. Otherwise, each character is
+ * passed to the default command. */
+void le_insert_pasted(const wchar_t *s)
+{
+    if (le_current_mode->default_command == cmd_self_insert) {
+        pasted_string = s;
+        le_invoke_command(insert_pasted, L'\0');
+        pasted_string = NULL;
+    } else {
+        for (; *s != L'\0'; s++) {
+            le_invoke_command(le_current_mode->default_command, *s);
+            if (le_editstate != LE_EDITSTATE_EDITING)
+                break;
+        }
+    }
+}
+
+/* Inserts `pasted_string' at the current position like `cmd_self_insert'. */
+void insert_pasted(wchar_t c __attribute__((unused)))
+{
+    ALERT_AND_RETURN_IF_PENDING;
+    clear_prediction();
+
+    const wchar_t *s = pasted_string;
+    if (is_overwriting())
+        while (*s != L'\0' && le_main_index < le_main_buffer.length)
+            le_main_buffer.contents[le_main_index++] = *s++;
+    size_t n = wcslen(s);
+    wb_ninsert_force(&le_main_buffer, le_main_index, s, n);
+    le_main_index += n;
+    reset_state();
+}
+
 /* Resets `state'. */
 void reset_state(void)
 {
@@ -3728,7 +3785,9 @@ void perform_search(const wchar_t *pattern,
         enum le_search_direction_T dir, enum le_search_type_T type)
 {
     const histlink_T *l = main_history_entry;
-    xfnmatch_T *xfnm;
+    const wchar_t *literal = L"";
+    xfnmflags_T flags = 0;
+    xfnmatch_T *xfnm = NULL;
 
     if (dir == FORWARD && l == Histlist)
         goto done;
@@ -3736,12 +3795,13 @@ void perform_search(const wchar_t *pattern,
     switch (type) {
         case SEARCH_PREFIX: {
             wchar_t *p = escape(pattern, NULL);
-            xfnm = xfnm_compile(p, XFNM_HEADONLY);
+            flags = XFNM_HEADONLY;
+            xfnm = xfnm_compile(p, flags);
             free(p);
+            literal = pattern;
             break;
         }
         case SEARCH_VI: {
-            xfnmflags_T flags = 0;
             if (pattern[0] == L'^') {
                 flags |= XFNM_HEADONLY;
                 pattern++;
@@ -3751,12 +3811,14 @@ void perform_search(const wchar_t *pattern,
                 }
             }
             xfnm = xfnm_compile(pattern, flags);
+            literal = is_literal_vi_search_pattern(pattern) ? pattern : L"";
             break;
         }
         case SEARCH_EMACS: {
             wchar_t *p = escape(pattern, NULL);
-            xfnm = xfnm_compile(p, 0);
+            xfnm = xfnm_compile(p, flags);
             free(p);
+            literal = pattern;
             break;
         }
         default:
@@ -3767,21 +3829,54 @@ void perform_search(const wchar_t *pattern,
         goto done;
     }
 
-    for (;;) {
-        switch (dir) {
-            case FORWARD:   l = l->next;  break;
-            case BACKWARD:  l = l->prev;  break;
+    char *mbsliteral = malloc_wcstombs(literal);
+    if (mbsliteral == NULL)
+        mbsliteral = xstrdup("");
+
+    /* If the pattern is a literal string that extends that of the last search
+     * of the same kind from the same position, no entry between the position
+     * and the last result can match, so the search can resume from the last
+     * result. */
+    if (last_performed_search.literal != NULL
+            && last_performed_search.start == l
+            && last_performed_search.direction == dir
+            && last_performed_search.type == type
+            && last_performed_search.flags == flags
+            && literal[0] != L'\0'
+            && matchwcsprefix(literal, last_performed_search.literal)) {
+        l = last_performed_search.result;
+        if (l != Histlist) {
+            switch (dir) {
+                case FORWARD:   l = l->prev;  break;
+                case BACKWARD:  l = l->next;  break;
+            }
+            l = search_history(l, dir == FORWARD, xfnm, mbsliteral);
         }
-        if (l == Histlist)
-            break;
-        if (xfnm_match(xfnm, ashistentry(l)->value) == 0)
-            break;
+    } else {
+        l = search_history(l, dir == FORWARD, xfnm, mbsliteral);
     }
+    free(mbsliteral);
     xfnm_free(xfnm);
+
+    free(last_performed_search.literal);
+    last_performed_search.literal =
+        (literal[0] != L'\0') ? xwcsdup(literal) : NULL;
+    last_performed_search.start = main_history_entry;
+    last_performed_search.direction = dir;
+    last_performed_search.type = type;
+    last_performed_search.flags = flags;
+    last_performed_search.result = l;
 done:
     le_search_result = l;
 }
 
+/* Checks if the specified vi search pattern matches only the pattern itself,
+ * that is, if it contains neither special characters nor backslashes. */
+bool is_literal_vi_search_pattern(const wchar_t *pattern)
+{
+    return wcspbrk(pattern, L"*?[\\") == NULL;
+}
+
 /* Redoes the last search. */
 void cmd_search_again(wchar_t c __attribute__((unused)))
 {
@@ -42,6 +42,8 @@ extern wchar_t *le_editing_finalize(void)
     __attribute__((malloc,warn_unused_result));
 extern void le_invoke_command(le_command_func_T *cmd, wchar_t arg)
     __attribute__((nonnull));
+extern void le_insert_pasted(const wchar_t *s)
+    __attribute__((nonnull));
 
 
 /********** Commands **********/
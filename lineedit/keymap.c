@@ -342,6 +342,15 @@ void le_set_mode(le_mode_id_T id)
     le_current_mode = le_id_to_mode(id);
 }
 
+/* Returns the keymap of the specified mode compiled into a flat table,
+ * compiling it if not yet compiled. */
+const triedfa_T *le_get_keymap_dfa(le_mode_T *mode)
+{
+    if (mode->keymapdfa == NULL)
+        mode->keymapdfa = trie_compilew(mode->keymap);
+    return mode->keymapdfa;
+}
+
 /* Generates completion candidates for editing command names matching the
  * pattern. */
 /* The prototype of this function is declared in "complete.h". */
@@ -474,6 +483,8 @@ int set_key_binding(
         register trie_T *t = le_modes[mode].keymap;
         t = trie_removew(t, keyseq);
         le_modes[mode].keymap = t;
+        triedfa_destroy(le_modes[mode].keymapdfa);
+        le_modes[mode].keymapdfa = NULL;
     } else {
         /* set key binding */
         char *mbsname = malloc_wcstombs(commandname);
@@ -488,6 +499,8 @@ int set_key_binding(
             register trie_T *t = le_modes[mode].keymap;
             t = trie_setw(t, keyseq, (trievalue_T) { .cmdfunc = cmd });
             le_modes[mode].keymap = t;
+            triedfa_destroy(le_modes[mode].keymapdfa);
+            le_modes[mode].keymapdfa = NULL;
         } else {
             xerror(0, Ngt("no such editing command `%ls'"), commandname);
             return Exit_FAILURE;
@@ -28,7 +28,11 @@
 typedef struct le_mode_T {
     le_command_func_T *default_command;
     struct trienode_T /* trie_T */ *keymap;
+    struct triedfa_T *keymapdfa;
 } le_mode_T;
+/* `keymapdfa' is `keymap' compiled into a flat table. It is NULL until
+ * compiled by `le_get_keymap_dfa' and reset to NULL whenever `keymap' is
+ * modified. */
 
 /* mode indices */
 typedef enum le_mode_id_T {
@@ -52,6 +56,8 @@ static inline le_mode_T *le_id_to_mode(le_mode_id_T modeid)
 
 extern void le_keymap_init(void);
 extern void le_set_mode(le_mode_id_T id);
+extern const struct triedfa_T *le_get_keymap_dfa(le_mode_T *mode)
+    __attribute__((nonnull));
 
 extern int bindkey_builtin(int argc, void **argv)
     __attribute__((nonnull));
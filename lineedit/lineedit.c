@@ -47,9 +47,10 @@ static int get_read_timeout(void)
 static char pop_prebuffer(void);
 static inline bool has_meta_bit(char c)
     __attribute__((pure));
-static inline trieget_T make_trieget(const wchar_t *keyseq)
-    __attribute__((nonnull,const));
 static void append_to_second_buffer(wchar_t wc);
+static void start_paste(void);
+static void read_pasted(void);
+static void end_paste(void);
 
 
 /* The state of line-editing. */
@@ -151,12 +152,24 @@ void le_display_size_changed(void)
 static bool reader_trap;
 /* Temporary buffer that contains bytes that are treated as input. */
 static xstrbuf_T reader_prebuffer;
+/* Bytes that have been read from the standard input but not yet processed.
+ * Usually input is read byte by byte so that bytes typed ahead for commands
+ * that are run after the current line is accepted are not consumed by the
+ * shell. A text pasted in the bracketed paste mode is read in larger chunks. */
+static char reader_input[4096];
+/* The index of the next byte to process and the number of bytes in
+ * `reader_input'. */
+static size_t reader_input_index, reader_input_length;
 /* Temporary buffer that contains input bytes. */
 static xstrbuf_T reader_first_buffer;
 /* Conversion state used in reading input. */
 static mbstate_t reader_state;
 /* Temporary buffer that contains input converted into wide characters. */
 static xwcsbuf_T reader_second_buffer;
+/* True while a text is being pasted in the bracketed paste mode. */
+static bool reader_pasting;
+/* Buffer that accumulates a text being pasted. */
+static xstrbuf_T reader_paste_buffer;
 /* If true, next input will be inserted directly to the main buffer. */
 bool le_next_verbatim;
 
@@ -167,6 +180,8 @@ void reader_init(bool trap)
     sb_init(&reader_first_buffer);
     memset(&reader_state, 0, sizeof reader_state);
     wb_init(&reader_second_buffer);
+    reader_pasting = false;
+    sb_init(&reader_paste_buffer);
     le_next_verbatim = false;
 }
 
@@ -175,10 +190,14 @@ void reader_finalize(void)
 {
     sb_destroy(&reader_first_buffer);
     wb_destroy(&reader_second_buffer);
+    sb_destroy(&reader_paste_buffer);
 }
 
 /* Reads the next byte from the standard input and take all the corresponding
  * actions.
+ * The display is not updated if more input is immediately available, so that
+ * a sequence of bytes that arrive at once is processed without redrawing the
+ * display for each byte.
  * May return without doing anything if a signal was caught, if the shell was
  * interrupted, etc.
  * The caller must check `le_state' after this function returned. This function
@@ -195,20 +214,25 @@ void read_next(void)
     if (c != '\0')
         goto direct_first_buffer;
 
-    le_display_update(true);
-    le_display_flush();
+    if (reader_input_index < reader_input_length)
+        goto next_byte;
 
-    /* wait for and read the next byte */
+    if (wait_for_input(STDIN_FILENO, false, 0) != W_READY) {
+        le_display_update(true);
+        le_display_flush();
+    }
+
+    /* wait for and read the next byte(s) */
     switch (wait_for_input(STDIN_FILENO, reader_trap,
             keycode_ambiguous ? get_read_timeout() : -1)) {
-        case W_READY:
-            switch (read(STDIN_FILENO, &c, 1)) {
+        case W_READY:;
+            ssize_t count = read(STDIN_FILENO, reader_input,
+                    reader_pasting ? sizeof reader_input : 1);
+            switch (count) {
                 case 0:
                     incomplete_wchar = keycode_ambiguous = false;
                     le_editstate = LE_EDITSTATE_ERROR;
                     return;
-                case 1:
-                    break;
                 case -1:
                     switch (errno) {
                         case EAGAIN:
@@ -224,8 +248,17 @@ void read_next(void)
                             return;
                     }
                 default:
-                    assert(false);
+                    assert(count > 0);
+                    reader_input_index = 0;
+                    reader_input_length = (size_t) count;
+                    break;
+            }
+next_byte:
+            if (reader_pasting) {
+                read_pasted();
+                return;
             }
+            c = reader_input[reader_input_index++];
             if (has_meta_bit(c)) {
                 sb_ccat(&reader_first_buffer, ESCAPE_CHAR);
                 sb_ccat(&reader_first_buffer, c & ~META_BIT);
@@ -252,18 +285,7 @@ direct_first_buffer:
     keycode_ambiguous = false;
     while (reader_first_buffer.length > 0) {
         /* check if `reader_first_buffer' is a special sequence */
-        int firstchar = (unsigned char) reader_first_buffer.contents[0];
-        trieget_T tg;
-        if (firstchar == le_interrupt_char)
-            tg = make_trieget(Key_interrupt);
-        else if (firstchar == le_eof_char)
-            tg = make_trieget(Key_eof);
-        else if (firstchar == le_kill_char)
-            tg = make_trieget(Key_kill);
-        else if (firstchar == le_erase_char)
-            tg = make_trieget(Key_erase);
-        else
-            tg = trie_get(le_keycodes,
+        trieget_T tg = triedfa_get(le_keycode_dfa,
                 reader_first_buffer.contents, reader_first_buffer.length);
         switch (tg.type) {
             case TG_NOMATCH:
@@ -272,6 +294,10 @@ direct_first_buffer:
                 if (timeout) {
             case TG_EXACTMATCH:
                     sb_remove(&reader_first_buffer, 0, tg.matchlength);
+                    if (wcscmp(tg.value.keyseq, Key_paste) == 0) {
+                        start_paste();
+                        return;
+                    }
                     wb_cat(&reader_second_buffer, tg.value.keyseq);
                     continue;
                 } else {
@@ -317,8 +343,8 @@ process_wide:
 process_keymap:
     while (reader_second_buffer.length > 0) {
         register wchar_t c;
-        trieget_T tg = trie_getw(
-                le_current_mode->keymap, reader_second_buffer.contents);
+        trieget_T tg = triedfa_getw(le_get_keymap_dfa(le_current_mode),
+                reader_second_buffer.contents);
         switch (tg.type) {
             case TG_NOMATCH:
                 assert(reader_second_buffer.length > 0);
@@ -351,6 +377,85 @@ process_keymap:
     }
 }
 
+/* Starts accumulating a text pasted in the bracketed paste mode.
+ * Bytes already read are processed as part of the pasted text. */
+void start_paste(void)
+{
+    reader_pasting = true;
+    sb_clear(&reader_paste_buffer);
+    sb_ncat_force(&reader_paste_buffer,
+            reader_first_buffer.contents, reader_first_buffer.length);
+    sb_clear(&reader_first_buffer);
+    read_pasted();
+}
+
+/* Moves bytes from `reader_input' to `reader_paste_buffer' until the end of the
+ * pasted text is found. If the end is found, the pasted text is inserted into
+ * the main buffer. */
+void read_pasted(void)
+{
+    if (le_paste_end == NULL) {
+        /* The terminal has been changed while pasting. */
+        end_paste();
+        return;
+    }
+
+    size_t endlen = strlen(le_paste_end);
+    while (reader_input_index < reader_input_length) {
+        sb_ccat(&reader_paste_buffer, reader_input[reader_input_index++]);
+        if (reader_paste_buffer.length >= endlen
+                && memcmp(&reader_paste_buffer.contents[
+                        reader_paste_buffer.length - endlen],
+                    le_paste_end, endlen) == 0) {
+            sb_truncate(&reader_paste_buffer,
+                    reader_paste_buffer.length - endlen);
+            end_paste();
+            return;
+        }
+    }
+}
+
+/* Inserts the accumulated pasted text into the main buffer and leaves the
+ * paste mode.
+ * Carriage returns are converted to newlines. Null characters and bytes that
+ * cannot be converted into wide characters are ignored. */
+void end_paste(void)
+{
+    xwcsbuf_T text;
+    mbstate_t state;
+    bool error = false;
+
+    wb_initwithmax(&text, reader_paste_buffer.length);
+    memset(&state, 0, sizeof state);
+    for (size_t i = 0; i < reader_paste_buffer.length; ) {
+        wchar_t wc;
+        size_t n = mbrtowc(&wc, &reader_paste_buffer.contents[i],
+                reader_paste_buffer.length - i, &state);
+        switch (n) {
+            case 0:
+                n = 1;
+                break;
+            case (size_t) -1:
+            case (size_t) -2:
+                error = true;
+                memset(&state, 0, sizeof state);
+                n = 1;
+                break;
+            default:
+                wb_wccat(&text, wc == L'\r' ? L'\n' : wc);
+                break;
+        }
+        i += n;
+    }
+    reader_pasting = false;
+    sb_clear(&reader_paste_buffer);
+
+    if (error)
+        lebuf_print_alert(true);
+    le_insert_pasted(text.contents);
+    wb_destroy(&text);
+}
+
 /* Returns a timeout value to be passed to the `wait_for_input' function.
  * The value is taken from the $YASH_LE_TIMEOUT variable. */
 int get_read_timeout(void)
@@ -410,15 +515,6 @@ bool has_meta_bit(char c)
     return (c & META_BIT) != 0;
 }
 
-trieget_T make_trieget(const wchar_t *keyseq)
-{
-    return (trieget_T) {
-        .type = TG_EXACTMATCH,
-        .matchlength = 1,
-        .value.keyseq = keyseq,
-    };
-}
-
 /* Appends the specified character to the second buffer.
  * If `le_next_verbatim' is true, the character is directly processed by the
  * default command. */
@@ -58,6 +58,12 @@
 
 
 /* terminfo capabilities */
+/* The following four are extended capabilities defined in ncurses 6.3 for the
+ * bracketed paste mode. */
+#define TI_BD      "BD"
+#define TI_BE      "BE"
+#define TI_PE      "PE"
+#define TI_PS      "PS"
 #define TI_am      "am"
 #define TI_bel     "bel"
 #define TI_blink   "blink"
@@ -74,10 +80,13 @@
 #define TI_cuf1    "cuf1"
 #define TI_cuu     "cuu"
 #define TI_cuu1    "cuu1"
+#define TI_dch     "dch"
+#define TI_dch1    "dch1"
 #define TI_dim     "dim"
 #define TI_ed      "ed"
 #define TI_el      "el"
 #define TI_flash   "flash"
+#define TI_ich     "ich"
 #define TI_invis   "invis"
 #define TI_kBEG    "kBEG"
 #define TI_kCAN    "kCAN"
@@ -252,6 +261,9 @@
  * because the $TERM variable has been changed. */
 _Bool le_need_term_update = 1;
 
+/* Incremented each time the terminfo data are (re)loaded. */
+unsigned le_terminfo_serial = 0;
+
 /* Number of lines, columns and colors available in the current terminal. */
 /* Initialized in `le_setupterm'. */
 int le_lines, le_columns, le_colors;
@@ -269,9 +281,20 @@ _Bool le_meta_bit8;
 /* Strings sent by terminal when special key is pressed.
  * The values of entries are `keyseq'. */
 trie_T *le_keycodes = NULL;
+/* `le_keycodes' and the special characters compiled into a flat table.
+ * Updated in `le_set_terminal'. */
+triedfa_T *le_keycode_dfa = NULL;
+/* True if `le_keycodes' has been changed since `le_keycode_dfa' was compiled.*/
+static _Bool keycode_dfa_stale = 1;
+
+/* String sent by the terminal at the end of pasted text in the bracketed paste
+ * mode, or NULL if the terminal does not support the mode. */
+const char *le_paste_end = NULL;
 
 /* True if the terminal is set to the keyboard-transmit mode. */
 static _Bool transmit_mode = 0;
+/* True if the terminal is set to the bracketed paste mode. */
+static _Bool paste_mode = 0;
 
 
 static inline int is_strcap_valid(const char *s)
@@ -289,6 +312,8 @@ static void print_color_code(long color, char *seta, char *set)
     __attribute__((nonnull));
 static void print_smkx(void);
 static void print_rmkx(void);
+static void print_be(void);
+static void print_bd(void);
 static int putchar_stderr(int c);
 
 
@@ -349,6 +374,8 @@ _Bool le_setupterm(_Bool bypass)
     if (le_lines <= 0 || le_columns <= 0)
         return 0;
 
+    le_terminfo_serial++;
+
     le_colors = tigetnum(TI_colors);
     le_ti_xmc = tigetnum(TI_xmc);
     le_ti_xenl = tigetflag(TI_xenl) > 0;
@@ -549,7 +576,20 @@ void set_up_keycodes(void)
             t = trie_set(t, seq, (trievalue_T) { .keyseq = keymap[i].keyseq });
     }
 
+    /* The bracketed paste mode is used only if the terminal defines all of the
+     * four capabilities. */
+    le_paste_end = NULL;
+    const char *ps = tigetstr(TI_PS), *pe = tigetstr(TI_PE);
+    if (is_strcap_valid(ps) && ps[0] != '\0'
+            && is_strcap_valid(pe) && pe[0] != '\0'
+            && is_strcap_valid(tigetstr(TI_BE))
+            && is_strcap_valid(tigetstr(TI_BD))) {
+        t = trie_set(t, ps, (trievalue_T) { .keyseq = Key_paste });
+        le_paste_end = pe;
+    }
+
     le_keycodes = t;
+    keycode_dfa_stale = 1;
 }
 
 /* Tries to print the specified capability string to the print buffer.
@@ -675,6 +715,28 @@ void lebuf_print_cuu(long count)
     lebuf.pos.line -= count;
 }
 
+/* Prints the "ich" code to the print buffer.
+ * (insert `count' blank characters at the cursor position)
+ * The "ich1" capability is not used because some terminals define it only for
+ * use in the insert mode.
+ * The cursor position is not changed.
+ * Returns true iff successful. */
+_Bool lebuf_print_ich(long count)
+{
+    return move_cursor_mul(TI_ich, count, 1);
+}
+
+/* Prints the "dch"/"dch1" code to the print buffer.
+ * (delete `count' characters at the cursor position)
+ * The cursor position is not changed.
+ * Returns true iff successful. */
+_Bool lebuf_print_dch(long count)
+{
+    if (count == 1 && move_cursor_1(TI_dch1, 1))
+        return 1;
+    return move_cursor_mul(TI_dch, count, 1) || move_cursor_1(TI_dch1, count);
+}
+
 /* Prints the "el" code to the print buffer. (clear to end of line)
  * Returns true iff successful. */
 _Bool lebuf_print_el(void)
@@ -847,6 +909,28 @@ void print_rmkx(void)
     }
 }
 
+/* Prints the "BE" code to the standard error to enable the bracketed paste
+ * mode if the terminal supports it. */
+void print_be(void)
+{
+    if (le_paste_end != NULL) {
+        tputs(tigetstr(TI_BE), 1, putchar_stderr);
+        paste_mode = 1;
+    }
+}
+
+/* Prints the "BD" code to the standard error if the `paste_mode' flag is set.
+ * The flag is cleared in this function. */
+void print_bd(void)
+{
+    if (paste_mode) {
+        char *v = tigetstr(TI_BD);
+        if (is_strcap_valid(v))
+            tputs(v, 1, putchar_stderr);
+        paste_mode = 0;
+    }
+}
+
 /* Like `putchar', but prints to `stderr'. */
 int putchar_stderr(int c)
 {
@@ -858,11 +942,16 @@ int putchar_stderr(int c)
 
 /* Special characters. */
 int le_eof_char, le_kill_char, le_interrupt_char, le_erase_char;
+/* Special characters compiled into `le_keycode_dfa'. */
+static int dfa_eof_char, dfa_kill_char, dfa_interrupt_char, dfa_erase_char;
 
 static struct termios original_terminal_state;
 
 static inline int normchar(cc_t c)
     __attribute__((const));
+static void update_keycode_dfa(void);
+static void set_special_char(int c, const wchar_t *keyseq)
+    __attribute__((nonnull));
 static void to_raw_mode(struct termios *term, _Bool isig)
     __attribute__((nonnull));
 static inline int xtcgetattr(int fd, struct termios *term)
@@ -891,6 +980,7 @@ _Bool le_set_terminal(void)
     le_kill_char      = normchar(term.c_cc[VKILL]);
     le_interrupt_char = normchar(term.c_cc[VINTR]);
     le_erase_char     = normchar(term.c_cc[VERASE]);
+    update_keycode_dfa();
 
     /* set attributes */
     to_raw_mode(&term, 0);
@@ -908,6 +998,7 @@ _Bool le_set_terminal(void)
 
     // XXX it should be configurable whether we print smkx or not.
     print_smkx();
+    print_be();
 
     return 1;
 
@@ -924,6 +1015,44 @@ int normchar(cc_t c)
         return (unsigned char) c;
 }
 
+/* Recompiles `le_keycode_dfa' if `le_keycodes' or the special characters have
+ * been changed. The special characters take precedence over `le_keycodes'. */
+void update_keycode_dfa(void)
+{
+    if (le_keycodes == NULL)
+        return;
+    if (!keycode_dfa_stale
+            && dfa_eof_char       == le_eof_char
+            && dfa_kill_char      == le_kill_char
+            && dfa_interrupt_char == le_interrupt_char
+            && dfa_erase_char     == le_erase_char)
+        return;
+
+    triedfa_destroy(le_keycode_dfa);
+    le_keycode_dfa = trie_compile(le_keycodes);
+
+    /* If some special characters are the same, the last one set wins. */
+    set_special_char(le_erase_char,     Key_erase);
+    set_special_char(le_kill_char,      Key_kill);
+    set_special_char(le_eof_char,       Key_eof);
+    set_special_char(le_interrupt_char, Key_interrupt);
+
+    keycode_dfa_stale = 0;
+    dfa_eof_char       = le_eof_char;
+    dfa_kill_char      = le_kill_char;
+    dfa_interrupt_char = le_interrupt_char;
+    dfa_erase_char     = le_erase_char;
+}
+
+/* Makes the specified special character unconditionally match `keyseq' in
+ * `le_keycode_dfa'. Does nothing if `c' is negative. */
+void set_special_char(int c, const wchar_t *keyseq)
+{
+    if (c >= 0)
+        triedfa_set_single(le_keycode_dfa, (unsigned char) c,
+                (trievalue_T) { .keyseq = keyseq });
+}
+
 /* Saves the current terminal state in `original_terminal_state'.
  * This function flushes the standard error before saving the state.
  * Returns true iff the standard input is a terminal and the terminal state was
@@ -941,6 +1070,7 @@ _Bool le_save_terminal(void)
  * successfully restored. */
 _Bool le_restore_terminal(void)
 {
+    print_bd();
     print_rmkx();
     fflush(stderr);
     return xtcsetattr(STDIN_FILENO, TCSADRAIN, &original_terminal_state) >= 0;
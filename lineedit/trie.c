@@ -47,6 +47,39 @@ typedef struct trienode_T {
 
 #define RAISE_COUNT(count) ((count) | 3)
 
+/* The number of keys that are looked up by direct indexing in a state of a
+ * compiled trie. Keys not less than this value are looked up by binary
+ * search. */
+#define DENSE_KEYS 256
+
+/* A state of a compiled trie.
+ * The transitions for keys in the range [`lo', `lo + span') are in the
+ * `transitions' array of the `triedfa_T' structure starting from index
+ * `dense'. The transitions for keys not less than DENSE_KEYS are in the
+ * `sparse' array starting from index `sparsestart', sorted by key. */
+typedef struct triestate_T {
+    bool valuevalid, haschildren;
+    trievalue_T value;
+    size_t lo, span, dense;
+    size_t sparsestart, sparsecount;
+} triestate_T;
+typedef struct triesparse_T {
+    wchar_t key;
+    size_t target;
+} triesparse_T;
+/* A trie compiled into a flat state-transition table.
+ * State 0 is the initial state. In `transitions' and `sparse', the target
+ * state is 0 if there is no transition. The initial state always has dense
+ * transitions for all keys less than DENSE_KEYS. */
+struct triedfa_T {
+    triestate_T *states;
+    size_t statecount, statecapacity;
+    size_t *transitions;
+    size_t transitioncount, transitioncapacity;
+    triesparse_T *sparse;
+    size_t sparsecount, sparsecapacity;
+};
+
 static inline bool isempty(const trienode_T *node)
     __attribute__((nonnull,pure));
 static trienode_T *ensure_size(trienode_T *node, size_t count)
@@ -68,6 +101,13 @@ static int foreachw(const trienode_T *t,
         void *v,
         xwcsbuf_T *buf)
     __attribute__((nonnull(1,2,4)));
+static size_t compile_node(triedfa_T *d, const trienode_T *node, bool wide)
+    __attribute__((nonnull));
+static size_t add_state(triedfa_T *d, size_t lo, size_t span, size_t sparsecount)
+    __attribute__((nonnull));
+static inline size_t transition(
+        const triedfa_T *d, const triestate_T *state, size_t key)
+    __attribute__((nonnull,pure));
 static const trieentry_T *most_probable_child(const trienode_T *node)
     __attribute__((nonnull,pure));
 
@@ -408,6 +448,213 @@ void trie_destroy(trienode_T *node)
 }
 
 
+/********** Compiled tries **********/
+
+/* Compiles the trie whose keys are byte strings into a flat state-transition
+ * table. The result must be freed with `triedfa_destroy' after use.
+ * The table is not affected by later modification of the trie. */
+triedfa_T *trie_compile(const trienode_T *t)
+{
+    triedfa_T *d = xmalloc(sizeof *d);
+    d->states = NULL, d->statecount = d->statecapacity = 0;
+    d->transitions = NULL, d->transitioncount = d->transitioncapacity = 0;
+    d->sparse = NULL, d->sparsecount = d->sparsecapacity = 0;
+    compile_node(d, t, false);
+    return d;
+}
+
+/* Compiles the trie whose keys are wide strings into a flat state-transition
+ * table. The result must be freed with `triedfa_destroy' after use.
+ * The table is not affected by later modification of the trie. */
+triedfa_T *trie_compilew(const trienode_T *t)
+{
+    triedfa_T *d = xmalloc(sizeof *d);
+    d->states = NULL, d->statecount = d->statecapacity = 0;
+    d->transitions = NULL, d->transitioncount = d->transitioncapacity = 0;
+    d->sparse = NULL, d->sparsecount = d->sparsecapacity = 0;
+    compile_node(d, t, true);
+    return d;
+}
+
+/* Adds states for the specified node and its descendants to the table.
+ * Returns the index of the state for the node. */
+size_t compile_node(triedfa_T *d, const trienode_T *node, bool wide)
+{
+    size_t lo = DENSE_KEYS, hi = 0, span, sparsecount = 0;
+    for (size_t i = 0; i < node->count; i++) {
+        size_t key = wide ? (size_t) node->entries[i].key.as_wchar
+                : (unsigned char) node->entries[i].key.as_char;
+        if (key < DENSE_KEYS) {
+            if (lo > key)
+                lo = key;
+            if (hi < key + 1)
+                hi = key + 1;
+        } else {
+            sparsecount++;
+        }
+    }
+    if (d->statecount == 0)
+        lo = 0, span = DENSE_KEYS;
+    else
+        span = (lo < hi) ? hi - lo : 0;
+
+    size_t index = add_state(d, lo, span, sparsecount);
+    d->states[index].valuevalid = node->valuevalid;
+    d->states[index].haschildren = node->count > 0;
+    d->states[index].value = node->value;
+
+    /* The entries of the node are sorted by key, so are the sparse ones. */
+    size_t sparseindex = d->states[index].sparsestart;
+    for (size_t i = 0; i < node->count; i++) {
+        size_t target = compile_node(d, node->entries[i].child, wide);
+        size_t key = wide ? (size_t) node->entries[i].key.as_wchar
+                : (unsigned char) node->entries[i].key.as_char;
+        if (key < DENSE_KEYS) {
+            d->transitions[d->states[index].dense + key - lo] = target;
+        } else {
+            d->sparse[sparseindex].key = node->entries[i].key.as_wchar;
+            d->sparse[sparseindex].target = target;
+            sparseindex++;
+        }
+    }
+    return index;
+}
+
+/* Adds a new state with the specified transition table size to the table.
+ * The new state has no value and no transitions.
+ * Returns the index of the new state. */
+size_t add_state(triedfa_T *d, size_t lo, size_t span, size_t sparsecount)
+{
+    if (d->statecount == d->statecapacity) {
+        d->statecapacity = (d->statecapacity == 0) ? 16
+                : mul(d->statecapacity, 2);
+        d->states = xreallocn(d->states, d->statecapacity, sizeof *d->states);
+    }
+    if (d->transitioncapacity - d->transitioncount < span) {
+        d->transitioncapacity = add(d->transitioncapacity, span);
+        d->transitioncapacity = mul(d->transitioncapacity, 2);
+        d->transitions = xreallocn(d->transitions,
+                d->transitioncapacity, sizeof *d->transitions);
+    }
+    if (d->sparsecapacity - d->sparsecount < sparsecount) {
+        d->sparsecapacity = add(d->sparsecapacity, sparsecount);
+        d->sparsecapacity = mul(d->sparsecapacity, 2);
+        d->sparse = xreallocn(d->sparse,
+                d->sparsecapacity, sizeof *d->sparse);
+    }
+
+    triestate_T *state = &d->states[d->statecount];
+    state->valuevalid = state->haschildren = false;
+    state->lo = lo;
+    state->span = span;
+    state->dense = d->transitioncount;
+    state->sparsestart = d->sparsecount;
+    state->sparsecount = sparsecount;
+    for (size_t i = 0; i < span; i++)
+        d->transitions[d->transitioncount + i] = 0;
+    d->transitioncount += span;
+    d->sparsecount += sparsecount;
+    return d->statecount++;
+}
+
+/* Makes the specified single-byte key sequence match the specified value,
+ * overriding any longer sequences that start with the key in the table. */
+void triedfa_set_single(triedfa_T *d, unsigned char key, trievalue_T v)
+{
+    size_t index = add_state(d, 0, 0, 0);
+    d->states[index].valuevalid = true;
+    d->states[index].value = v;
+    d->transitions[d->states[0].dense + key] = index;
+    d->states[0].haschildren = true;
+}
+
+/* Returns the index of the state to which the specified state transits on the
+ * specified key. Returns 0 if there is no transition. */
+size_t transition(const triedfa_T *d, const triestate_T *state, size_t key)
+{
+    if (key < DENSE_KEYS) {
+        key -= state->lo;  /* may wrap around */
+        return (key < state->span) ? d->transitions[state->dense + key] : 0;
+    }
+
+    const triesparse_T *sparse = &d->sparse[state->sparsestart];
+    size_t count = state->sparsecount;
+    while (count > 0) {
+        size_t i = count / 2;
+        if ((size_t) sparse[i].key == key)
+            return sparse[i].target;
+        if ((size_t) sparse[i].key < key) {
+            sparse = &sparse[i + 1];
+            count -= i + 1;
+        } else {
+            count = i;
+        }
+    }
+    return 0;
+}
+
+/* Matches `keystr' with the compiled trie in the same way as `trie_get'. */
+trieget_T triedfa_get(const triedfa_T *d, const char *keystr, size_t keylen)
+{
+    trieget_T result = { .type = TG_NOMATCH, .matchlength = 0, };
+    const triestate_T *state = &d->states[0];
+
+    for (size_t i = 0; ; i++) {
+        if (state->valuevalid) {
+            result.type = TG_EXACTMATCH;
+            result.matchlength = i;
+            result.value = state->value;
+        }
+        if (i == keylen) {
+            if (state->haschildren)
+                result.type |= TG_PREFIXMATCH;
+            break;
+        }
+        size_t next = transition(d, state, (unsigned char) keystr[i]);
+        if (next == 0)
+            break;
+        state = &d->states[next];
+    }
+    return result;
+}
+
+/* Matches `keywcs' with the compiled trie in the same way as `trie_getw'. */
+trieget_T triedfa_getw(const triedfa_T *d, const wchar_t *keywcs)
+{
+    trieget_T result = { .type = TG_NOMATCH, .matchlength = 0, };
+    const triestate_T *state = &d->states[0];
+
+    for (size_t i = 0; ; i++) {
+        if (state->valuevalid) {
+            result.type = TG_EXACTMATCH;
+            result.matchlength = i;
+            result.value = state->value;
+        }
+        if (keywcs[i] == L'\0') {
+            if (state->haschildren)
+                result.type |= TG_PREFIXMATCH;
+            break;
+        }
+        size_t next = transition(d, state, (size_t) keywcs[i]);
+        if (next == 0)
+            break;
+        state = &d->states[next];
+    }
+    return result;
+}
+
+/* Frees the compiled trie. */
+void triedfa_destroy(triedfa_T *d)
+{
+    if (d != NULL) {
+        free(d->states);
+        free(d->transitions);
+        free(d->sparse);
+        free(d);
+    }
+}
+
+
 /********** Functions for prediction **********/
 
 /* Adds the given probability value `p' to each node on the given key string
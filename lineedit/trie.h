@@ -29,6 +29,7 @@ typedef union trievalue_T {
     double probability;
 } trievalue_T;
 typedef struct trienode_T trie_T;
+typedef struct triedfa_T triedfa_T;
 typedef struct trieget_T {
     enum {
         TG_NOMATCH     = 0,
@@ -63,6 +64,19 @@ extern int trie_foreachw(const trie_T *t,
     __attribute__((nonnull(1,2)));
 extern void trie_destroy(trie_T *t);
 
+extern triedfa_T *trie_compile(const trie_T *t)
+    __attribute__((nonnull,malloc,warn_unused_result));
+extern triedfa_T *trie_compilew(const trie_T *t)
+    __attribute__((nonnull,malloc,warn_unused_result));
+extern void triedfa_set_single(triedfa_T *d, unsigned char key, trievalue_T v)
+    __attribute__((nonnull));
+extern trieget_T triedfa_get(
+        const triedfa_T *d, const char *keystr, size_t keylen)
+    __attribute__((nonnull));
+extern trieget_T triedfa_getw(const triedfa_T *d, const wchar_t *keywcs)
+    __attribute__((nonnull));
+extern void triedfa_destroy(triedfa_T *d);
+
 extern trie_T *trie_add_probability(trie_T *t, const wchar_t *keywcs, double p)
     __attribute__((nonnull,malloc,warn_unused_result));
 extern wchar_t *trie_probable_key(const trie_T *t, const wchar_t *skipkey)
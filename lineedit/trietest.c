@@ -2,17 +2,33 @@
 //   make trie.o
 //   (cd .. && make strbuf.o)
 //   c99 -o trietest trietest.c trie.o ../strbuf.o ../util.o
+// Run `./trietest -b' to benchmark key code dispatch.
 #include <assert.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include "trie.h"
 
+/* Checks that the compiled trie gives the same result as the trie. */
+trieget_T get(const trie_T *t, const char *key, size_t keylen)
+{
+    trieget_T tg = trie_get(t, key, keylen);
+    triedfa_T *d = trie_compile(t);
+    trieget_T tgd = triedfa_get(d, key, keylen);
+    triedfa_destroy(d);
+
+    assert(tg.type == tgd.type);
+    assert(tg.matchlength == tgd.matchlength);
+    assert(!(tg.type & TG_EXACTMATCH) || tg.value.keyseq == tgd.value.keyseq);
+    return tg;
+}
+
 void print(const trie_T *t, const char *key)
 {
-    trieget_T tg = trie_get(t, key, strlen(key));
+    trieget_T tg = get(t, key, strlen(key));
 
     printf("%-10s: ", key);
     switch (tg.type) {
@@ -36,7 +52,7 @@ void print(const trie_T *t, const char *key)
 
 void print_null(const trie_T *t)
 {
-    trieget_T tg = trie_get(t, "", 1);
+    trieget_T tg = get(t, "", 1);
 
     printf("<null>    : ");
     switch (tg.type) {
@@ -58,9 +74,84 @@ void print_null(const trie_T *t)
     }
 }
 
+/* Dispatches the input the same way as the line-editing reader does: the
+ * longest matching key code is consumed, or a single byte if none matches.
+ * Returns the number of dispatched keys. */
+size_t dispatch(const trie_T *t, const triedfa_T *d, const char *in, size_t len)
+{
+    size_t keys = 0;
+    while (len > 0) {
+        trieget_T tg = (d != NULL) ? triedfa_get(d, in, len)
+                                   : trie_get(t, in, len);
+        size_t n = (tg.type & TG_EXACTMATCH) ? tg.matchlength : 1;
+        in += n, len -= n;
+        keys++;
+    }
+    return keys;
+}
+
+/* Replays an input stream of typed text mixed with escape sequences and
+ * prints the number of keystrokes dispatched per second with the trie and the
+ * compiled trie. */
+void bench(void)
+{
+    static const char *const seqs[] = {
+        "\33[A", "\33[B", "\33[C", "\33[D", "\33[H", "\33[F", "\33OA",
+        "\33OB", "\33OC", "\33OD", "\33OH", "\33OF", "\33[2~", "\33[3~",
+        "\33[5~", "\33[6~", "\33OP", "\33OQ", "\33OR", "\33OS", "\33[15~",
+        "\33[17~", "\33[18~", "\33[19~", "\33[20~", "\33[21~", "\33[23~",
+        "\33[24~", "\33[1;2A", "\33[1;2B", "\33[1;2C", "\33[1;2D",
+        "\33[1;5A", "\33[1;5B", "\33[1;5C", "\33[1;5D", "\33[200~",
+        "\1", "\2", "\3", "\4", "\5", "\6", "\7", "\10", "\11", "\12",
+        "\13", "\14", "\15", "\16", "\17", "\20", "\21", "\22", "\23",
+        "\24", "\25", "\26", "\27", "\30", "\31", "\32", "\33", "\34",
+        "\35", "\36", "\37", "\177",
+    };
+    const size_t seqcount = sizeof seqs / sizeof *seqs;
+
+    trie_T *t = trie_create();
+    for (size_t i = 0; i < seqcount; i++)
+        t = trie_set(t, seqs[i], (trievalue_T) { .keyseq = L"" });
+    triedfa_T *d = trie_compile(t);
+
+    /* ten typed characters per escape sequence on average */
+    size_t len = 0, capacity = 1 << 20;
+    char *in = malloc(capacity + 16);
+    srand(1);
+    while (len < capacity) {
+        if (rand() % 10 == 0) {
+            const char *seq = seqs[rand() % seqcount];
+            size_t n = strlen(seq);
+            memcpy(&in[len], seq, n);
+            len += n;
+        } else {
+            in[len++] = 'a' + rand() % 26;
+        }
+    }
+
+    for (int i = 0; i < 2; i++) {
+        const triedfa_T *dd = (i == 0) ? NULL : d;
+        size_t keys = 0;
+        clock_t start = clock(), elapsed;
+        do {
+            keys += dispatch(t, dd, in, len);
+            elapsed = clock() - start;
+        } while (elapsed < CLOCKS_PER_SEC);
+        printf("%-6s: %.0f keys/sec\n", (i == 0) ? "trie" : "dfa",
+                (double) keys * CLOCKS_PER_SEC / elapsed);
+    }
+
+    free(in);
+    triedfa_destroy(d);
+    trie_destroy(t);
+}
+
 int main(int argc, char **argv)
 {
-    (void) argc, (void) argv;
+    if (argc > 1 && strcmp(argv[1], "-b") == 0) {
+        bench();
+        exit(EXIT_SUCCESS);
+    }
 
     trie_T *t = trie_create();
 
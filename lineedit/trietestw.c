@@ -9,9 +9,23 @@
 #include <unistd.h>
 #include "trie.h"
 
-void print(const trie_T *t, const wchar_t *key)
+/* Checks that the compiled trie gives the same result as the trie. */
+trieget_T getw(const trie_T *t, const wchar_t *key)
 {
     trieget_T tg = trie_getw(t, key);
+    triedfa_T *d = trie_compilew(t);
+    trieget_T tgd = triedfa_getw(d, key);
+    triedfa_destroy(d);
+
+    assert(tg.type == tgd.type);
+    assert(tg.matchlength == tgd.matchlength);
+    assert(!(tg.type & TG_EXACTMATCH) || tg.value.keyseq == tgd.value.keyseq);
+    return tg;
+}
+
+void print(const trie_T *t, const wchar_t *key)
+{
+    trieget_T tg = getw(t, key);
 
     printf("%-10ls: ", key);
     switch (tg.type) {
@@ -55,6 +69,10 @@ int main(int argc, char **argv)
     t = trie_setw(t, L"abcg", make_trievalue(L"ABCG"));
     t = trie_setw(t, L"abch", make_trievalue(L"ABCH"));
     t = trie_setw(t, L"b", make_trievalue(L"B"));
+    t = trie_setw(t, L"\x3042", make_trievalue(L"A1"));
+    t = trie_setw(t, L"\x3042\x3044", make_trievalue(L"A1A2"));
+    t = trie_setw(t, L"\x3042\x3046", make_trievalue(L"A1A3"));
+    t = trie_setw(t, L"\x3042" L"a\x3048", make_trievalue(L"A1aA4"));
 
     print(t, L"");
     print(t, L"ab");
@@ -68,6 +86,12 @@ int main(int argc, char **argv)
     print(t, L"ax");
     print(t, L"b");
     print(t, L"x");
+    print(t, L"\x3042");
+    print(t, L"\x3042\x3044");
+    print(t, L"\x3042\x3046x");
+    print(t, L"\x3042\x3048");
+    print(t, L"\x3042" L"a");
+    print(t, L"\x3042" L"a\x3048");
 
     t = trie_removew(t, L"b");
     t = trie_removew(t, L"c");
@@ -122,6 +122,12 @@ bool shopt_xtrace = false;
 /* If set, the "xtrace" option is not ignored while executing auxiliary
  * commands. */
 bool shopt_traceall = true;
+/* If set, the execution time of functions and and-or lists is measured.
+ * Corresponds to the --profiling option. */
+bool shopt_profiling = false;
+/* If set, the resource usage of each foreground job is printed to the
+ * standard error. Corresponds to the --logrusage option. */
+bool shopt_logrusage = false;
 
 #if YASH_ENABLE_HISTORY
 /* If set, lines that start with a space are not saved in the history.
@@ -249,6 +255,7 @@ static const struct option_T shell_options[] = {
 #endif
     { 0,    0,    L"log",            &shopt_log,            true, },
     { L'l', 0,    L"login",          &is_login_shell,       false, },
+    { 0,    0,    L"logrusage",      &shopt_logrusage,      true, },
     { 0,    0,    L"markdirs",       &shopt_markdirs,       true, },
     { L'm', 0,    L"monitor",        &do_job_control,       true, },
     { L'b', 0,    L"notify",         &shopt_notify,         true, },
@@ -258,6 +265,7 @@ static const struct option_T shell_options[] = {
     { 0,    0,    L"nullglob",       &shopt_nullglob,       true, },
     { 0,    0,    L"pipefail",       &shopt_pipefail,       true, },
     { 0,    0,    L"posixlycorrect", &posixly_correct,      true, },
+    { 0,    0,    L"profiling",      &shopt_profiling,      true, },
     { L's', 0,    L"stdin",          &shopt_stdin,          false, },
     { 0,    0,    L"traceall",       &shopt_traceall,       true, },
     { 0,    L'u', L"unset",          &shopt_unset,          true, },
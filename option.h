@@ -44,7 +44,7 @@ extern _Bool do_job_control, shopt_notify, shopt_notifyle,
 extern _Bool shopt_allexport, shopt_hashondef, shopt_forlocal;
 extern _Bool shopt_errexit, shopt_errreturn, shopt_pipefail, shopt_unset,
        shopt_exec, shopt_ignoreeof, shopt_verbose, shopt_xtrace;
-extern _Bool shopt_traceall;
+extern _Bool shopt_traceall, shopt_profiling, shopt_logrusage;
 #if YASH_ENABLE_HISTORY
 extern _Bool shopt_histspace;
 #endif
@@ -108,6 +108,7 @@ void comsfree(command_T *c)
                 free(c->c_forname);
                 plfree(c->c_forwords, wordfree_vp);
                 andorsfree(c->c_forcmds);
+                wordfree(c->c_forjobs);
                 break;
             case CT_WHILE:
                 andorsfree(c->c_whlcond);
@@ -2515,6 +2516,32 @@ command_T *parse_for(parsestate_T *ps)
     result->c_type = CT_FOR;
     result->c_lineno = ps->info->lineno;
     result->c_redirs = NULL;
+    result->c_forjobs = NULL;
+    result->c_forkeep = false;
+
+    /* parse the -P and -k options of the parallel for loop */
+    while (!posixly_correct && ps->token != NULL
+            && ps->next_index - ps->index == 2
+            && ps->src.contents[ps->index] == L'-') {
+        wchar_t opt = ps->src.contents[ps->index + 1];
+        if (opt == L'P') {
+            next_token(ps);
+            if (ps->token == NULL) {
+                serror(ps, Ngt("a word is required after `%ls'"), L"-P");
+            } else {
+                wordfree(result->c_forjobs);
+                result->c_forjobs = ps->token, ps->token = NULL;
+                next_token(ps);
+            }
+        } else if (opt == L'k') {
+            result->c_forkeep = true;
+            next_token(ps);
+        } else {
+            break;
+        }
+    }
+    if (result->c_forkeep && result->c_forjobs == NULL)
+        serror(ps, Ngt("the -k option must be used with the -P option"));
 
     result->c_forname =
         xwcsndup(&ps->src.contents[ps->index], ps->next_index - ps->index);
@@ -3647,6 +3674,13 @@ void print_for(
     assert(c->c_type == CT_FOR);
 
     wb_cat(&pr->buffer, L"for ");
+    if (c->c_forjobs != NULL) {
+        wb_cat(&pr->buffer, L"-P ");
+        print_word(pr, c->c_forjobs, indent);
+        wb_wccat(&pr->buffer, L' ');
+        if (c->c_forkeep)
+            wb_cat(&pr->buffer, L"-k ");
+    }
     wb_cat(&pr->buffer, c->c_forname);
     if (c->c_forwords != NULL) {
         wb_cat(&pr->buffer, L" in");
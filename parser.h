@@ -86,6 +86,8 @@ typedef struct command_T {
             wchar_t         *forname;  /* loop variable of for loop */
             void           **forwords; /* words assigned to loop variable */
             struct and_or_T *forcmds;  /* commands executed in for loop */
+            struct wordunit_T *forjobs; /* max # of parallel iterations */
+            _Bool            forkeep;  /* keep the order of output? */
         } forloop;
         struct {
             _Bool            whltype;  /* 1 for while loop, 0 for until */
@@ -110,6 +112,8 @@ typedef struct command_T {
 #define c_forname  c_content.forloop.forname
 #define c_forwords c_content.forloop.forwords
 #define c_forcmds  c_content.forloop.forcmds
+#define c_forjobs  c_content.forloop.forjobs
+#define c_forkeep  c_content.forloop.forkeep
 #define c_whltype  c_content.whileloop.whltype
 #define c_whlcond  c_content.whileloop.whlcond
 #define c_whlcmds  c_content.whileloop.whlcmds
@@ -121,7 +125,10 @@ typedef struct command_T {
 /* `c_words' and `c_forwords' are NULL-terminated arrays of pointers to
  * `wordunit_T' that are cast to `void *'.
  * If `c_forwords' is NULL, the for loop doesn't have the "in" clause.
- * If `c_forwords[0]' is NULL, the "in" clause exists and is empty. */
+ * If `c_forwords[0]' is NULL, the "in" clause exists and is empty.
+ * If `c_forjobs' is non-NULL, the for loop has the -P option and the iterations
+ * are executed in parallel subshells. `c_forkeep' is true if the loop also has
+ * the -k option. */
 
 /* condition and commands of an if command */
 typedef struct ifcommand_T {
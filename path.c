@@ -23,11 +23,17 @@
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#if HAVE_GETGRENT
+# include <grp.h>
+#endif
 #include <inttypes.h>
 #if HAVE_GETTEXT
 # include <libintl.h>
 #endif
 #include <limits.h>
+#if HAVE_GETHOSTENT
+# include <netdb.h>
+#endif
 #if HAVE_PATHS_H
 # include <paths.h>
 #endif
@@ -36,6 +42,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
@@ -68,6 +75,40 @@ extern int eaccess(const char *path, int amode)
 # endif
 #endif
 
+#if HAVE_GETPWENT
+# ifndef setpwent
+extern void setpwent(void);
+# endif
+# ifndef getpwent
+extern struct passwd *getpwent(void);
+# endif
+# ifndef endpwent
+extern void endpwent(void);
+# endif
+#endif
+#if HAVE_GETGRENT
+# if 0 /* avoid conflict on BSD */
+extern void setgrent(void);
+# endif
+# ifndef getgrent
+extern struct group *getgrent(void);
+# endif
+# ifndef endgrent
+extern void endgrent(void);
+# endif
+#endif
+#if HAVE_GETHOSTENT
+# if 0 /* avoid conflict on SunOS */
+extern void sethostent(int);
+# endif
+# ifndef gethostent
+extern struct hostent *gethostent(void);
+# endif
+# if 0 /* avoid conflict on SunOS */
+extern void endhostent(void);
+# endif
+#endif
+
 static bool check_access(const char *path, mode_t mode, int amode)
     __attribute__((nonnull));
 
@@ -523,14 +564,25 @@ const wchar_t *get_home_directory(const wchar_t *username, bool forcelookup)
     if (mbsusername == NULL)
         return NULL;
 
-    struct passwd *pw = xgetpwnam(mbsusername);
+    /* Use the user database snapshot if completion has taken one. */
+    const char *home = NULL;
+    if (!forcelookup) {
+        const nssentry_T *e = find_nss_entry(NSSDB_PASSWD, mbsusername);
+        if (e != NULL)
+            home = e->home;
+    }
+    if (home == NULL) {
+        struct passwd *pw = xgetpwnam(mbsusername);
+        if (pw != NULL)
+            home = pw->pw_dir;
+    }
     free(mbsusername);
-    if (pw == NULL)
+    if (home == NULL)
         return NULL;
 
     xwcsbuf_T dir;
     wb_init(&dir);
-    if (wb_mbscat(&dir, pw->pw_dir) != NULL) {
+    if (wb_mbscat(&dir, home) != NULL) {
         wb_destroy(&dir);
         return NULL;
     }
@@ -549,6 +601,567 @@ void forget_home_directory(const wchar_t *username)
 }
 
 
+/********** User, Group, and Host Databases **********/
+
+/* Enumerating the user, group, and host databases may take a long time if the
+ * databases are provided by network services. To avoid enumerating them every
+ * time completion is performed, a snapshot of each database is kept and reused
+ * until it expires. A snapshot expires after `NSS_SNAPSHOT_LIFETIME' seconds or
+ * when the local file that backs the database is modified. */
+
+#define NSS_SNAPSHOT_LIFETIME 300  /* seconds */
+
+/* A snapshot of a database. */
+typedef struct nsssnapshot_T {
+    bool taken;           /* whether the snapshot is available */
+    time_t time;          /* when the snapshot was taken */
+    bool file_exists;     /* whether the backing file existed */
+    struct stat st;       /* status of the backing file */
+    size_t count;         /* number of the entries */
+    nssentry_T *entries;  /* entries sorted by name */
+} nsssnapshot_T;
+
+static void take_nss_snapshot(nssdb_T db, nsssnapshot_T *snapshot,
+        bool cancelled(void))
+    __attribute__((nonnull(2)));
+static bool is_nss_snapshot_fresh(nssdb_T db);
+static int nss_entry_cmp(const void *e1, const void *e2)
+    __attribute__((nonnull,pure));
+static void add_nss_entry(plist_T *list,
+        const char *name, const char *info, const char *home)
+    __attribute__((nonnull(1,2)));
+
+/* Snapshots of the databases, indexed by `nssdb_T' values. */
+static nsssnapshot_T nss_snapshots[NSSDB_COUNT];
+
+/* The pathnames of the files that back the databases. */
+static const char *const nss_files[NSSDB_COUNT] = {
+    [NSSDB_PASSWD] = "/etc/passwd",
+    [NSSDB_GROUP]  = "/etc/group",
+    [NSSDB_HOSTS]  = "/etc/hosts",
+};
+
+/* Returns the entries of the specified database whose name starts with
+ * `prefix'. The number of the entries is assigned to `*countp'. The entries are
+ * sorted by name.
+ * If the snapshot of the database is not fresh, a new snapshot is taken. While
+ * the database is enumerated, `cancelled' is called repeatedly (unless it is
+ * NULL) and, if it returns true, the enumeration is aborted and NULL is
+ * returned with `*countp' set to zero.
+ * The returned entries are valid until the snapshot is discarded. */
+const nssentry_T *get_nss_entries(nssdb_T db, const char *prefix,
+        size_t *countp, bool cancelled(void))
+{
+    nsssnapshot_T *snapshot = &nss_snapshots[db];
+    if (!is_nss_snapshot_fresh(db)) {
+        discard_nss_snapshot(db);
+        take_nss_snapshot(db, snapshot, cancelled);
+        if (!snapshot->taken) {
+            *countp = 0;
+            return NULL;
+        }
+    }
+
+    /* binary search for the first entry not less than `prefix' */
+    size_t min = 0, max = snapshot->count;
+    while (min < max) {
+        size_t mid = min + (max - min) / 2;
+        if (strcmp(snapshot->entries[mid].name, prefix) < 0)
+            min = mid + 1;
+        else
+            max = mid;
+    }
+
+    size_t prefixlen = strlen(prefix), count = 0;
+    while (min + count < snapshot->count && strncmp(
+                snapshot->entries[min + count].name, prefix, prefixlen) == 0)
+        count++;
+
+    *countp = count;
+    return &snapshot->entries[min];
+}
+
+/* Returns the entry of the specified name in the database.
+ * Unlike `get_nss_entries', this function never enumerates the database: NULL
+ * is returned if there is no fresh snapshot or the name is not found in it. */
+const nssentry_T *find_nss_entry(nssdb_T db, const char *name)
+{
+    if (!is_nss_snapshot_fresh(db))
+        return NULL;
+
+    const nsssnapshot_T *snapshot = &nss_snapshots[db];
+    nssentry_T key = { .name = (char *) name, };
+    return bsearch(&key, snapshot->entries, snapshot->count,
+            sizeof *snapshot->entries, nss_entry_cmp);
+}
+
+/* Discards the snapshot of the specified database so that the database is
+ * enumerated again next time it is needed. */
+void discard_nss_snapshot(nssdb_T db)
+{
+    nsssnapshot_T *snapshot = &nss_snapshots[db];
+    for (size_t i = 0; i < snapshot->count; i++) {
+        free(snapshot->entries[i].name);
+        free(snapshot->entries[i].info);
+        free(snapshot->entries[i].home);
+    }
+    free(snapshot->entries);
+    *snapshot = (nsssnapshot_T) { .taken = false, };
+}
+
+/* Checks if the specified database has a snapshot that has not expired. */
+bool is_nss_snapshot_fresh(nssdb_T db)
+{
+    const nsssnapshot_T *snapshot = &nss_snapshots[db];
+    if (!snapshot->taken)
+        return false;
+
+    time_t now = time(NULL);
+    if (now < snapshot->time || now - snapshot->time >= NSS_SNAPSHOT_LIFETIME)
+        return false;
+
+    struct stat st;
+    bool file_exists = stat(nss_files[db], &st) >= 0;
+    if (file_exists != snapshot->file_exists)
+        return false;
+    return !file_exists || (stat_result_same_file(&st, &snapshot->st)
+            && st.st_size == snapshot->st.st_size
+            && st.st_mtime == snapshot->st.st_mtime);
+}
+
+/* Enumerates the specified database and stores the result in `snapshot',
+ * which must have been discarded.
+ * If `cancelled' returns true, the snapshot is left not taken. */
+void take_nss_snapshot(nssdb_T db, nsssnapshot_T *snapshot,
+        bool cancelled(void))
+{
+    plist_T list;
+    pl_init(&list);
+
+    snapshot->time = time(NULL);
+    snapshot->file_exists = stat(nss_files[db], &snapshot->st) >= 0;
+
+    bool aborted = false;
+    switch (db) {
+        case NSSDB_PASSWD:
+#if HAVE_GETPWENT
+        {
+            struct passwd *pwd;
+            setpwent();
+            while (!(aborted = cancelled != NULL && cancelled())
+                    && (pwd = getpwent()) != NULL)
+                add_nss_entry(&list, pwd->pw_name,
+# if HAVE_PW_GECOS
+                        pwd->pw_gecos,
+# else
+                        NULL,
+# endif
+                        pwd->pw_dir);
+            endpwent();
+        }
+#endif
+            break;
+        case NSSDB_GROUP:
+#if HAVE_GETGRENT
+        {
+            struct group *grp;
+            setgrent();
+            while (!(aborted = cancelled != NULL && cancelled())
+                    && (grp = getgrent()) != NULL)
+                add_nss_entry(&list, grp->gr_name, NULL, NULL);
+            endgrent();
+        }
+#endif
+            break;
+        case NSSDB_HOSTS:
+#if HAVE_GETHOSTENT
+        {
+            struct hostent *host;
+            sethostent(true);
+            while (!(aborted = cancelled != NULL && cancelled())
+                    && (host = gethostent()) != NULL) {
+                add_nss_entry(&list, host->h_name, NULL, NULL);
+                if (host->h_aliases != NULL)
+                    for (char *const *a = host->h_aliases; *a != NULL; a++)
+                        add_nss_entry(&list, *a, NULL, NULL);
+            }
+            endhostent();
+        }
+#endif
+            break;
+        case NSSDB_COUNT:
+            assert(false);
+    }
+
+    snapshot->count = list.length;
+    snapshot->entries = xmallocn(list.length, sizeof *snapshot->entries);
+    for (size_t i = 0; i < list.length; i++) {
+        nssentry_T *e = list.contents[i];
+        snapshot->entries[i] = *e;
+        free(e);
+    }
+    pl_destroy(&list);
+    qsort(snapshot->entries, snapshot->count, sizeof *snapshot->entries,
+            nss_entry_cmp);
+    snapshot->taken = true;
+
+    if (aborted)
+        discard_nss_snapshot(db);
+}
+
+/* Compares the names of two `nssentry_T's. */
+int nss_entry_cmp(const void *e1, const void *e2)
+{
+    const nssentry_T *entry1 = e1, *entry2 = e2;
+    return strcmp(entry1->name, entry2->name);
+}
+
+/* Adds a new `nssentry_T' to `list'. `info' and `home' may be NULL. */
+void add_nss_entry(plist_T *list,
+        const char *name, const char *info, const char *home)
+{
+    nssentry_T *e = xmalloc(sizeof *e);
+    e->name = xstrdup(name);
+    e->info = (info != NULL) ? xstrdup(info) : NULL;
+    e->home = (home != NULL) ? xstrdup(home) : NULL;
+    pl_add(list, e);
+}
+
+
+/********** Script Bundles **********/
+
+/* A script bundle is a single file that contains all the script files in a
+ * directory under $YASH_LOADPATH. The bundle for directory "foo" is named
+ * "foo.bundle" and placed next to the directory. A script in the directory can
+ * be autoloaded from the bundle without searching for and opening the script
+ * file itself.
+ * A bundle file starts with an index, which consists of the `BUNDLE_MAGIC' line
+ * followed by lines each containing the size (in bytes) and the name of a
+ * member script separated by a space. The index is terminated by an empty line,
+ * which is followed by the contents of the member scripts concatenated in the
+ * order of the index.
+ * When the index is read, the whole file is mapped into memory (or read into a
+ * buffer if it cannot be mapped) so that the members can be loaded without
+ * accessing the file again. */
+
+#define BUNDLE_SUFFIX ".bundle"
+#define BUNDLE_MAGIC  "# yash script bundle\n"
+
+/* An entry of a bundle index. */
+typedef struct bundlemember_T {
+    size_t offset;  /* position of the contents in the bundle file */
+    size_t length;  /* size of the contents in bytes */
+    char name[];
+} bundlemember_T;
+
+/* The index of a bundle file. */
+typedef struct bundle_T {
+    struct stat stat;     /* status of the file when the index was read */
+    hashtable_T members;  /* maps member names to `bundlemember_T's */
+    char *contents;       /* contents of the whole file */
+    bool mapped;          /* whether `contents' is mapped by `mmap' */
+    char path[];
+} bundle_T;
+
+static const bundle_T *get_bundle(const char *path)
+    __attribute__((nonnull));
+static bundle_T *read_bundle(const char *path, const struct stat *st)
+    __attribute__((nonnull,malloc,warn_unused_result));
+static char *read_bundle_contents(int fd, size_t size, bool *mappedp)
+    __attribute__((nonnull,warn_unused_result));
+static bool read_bundle_index(bundle_T *bundle)
+    __attribute__((nonnull));
+static void remove_stale_bundle_members(bundle_T *bundle)
+    __attribute__((nonnull));
+static void free_bundle(bundle_T *bundle)
+    __attribute__((nonnull));
+static bool is_same_bundle_file(const struct stat *st1, const struct stat *st2)
+    __attribute__((nonnull,pure));
+static wchar_t *read_bundle_member(
+        const bundle_T *bundle, const bundlemember_T *member)
+    __attribute__((nonnull,malloc,warn_unused_result));
+
+/* A hashtable from the pathnames of bundle files to their `bundle_T' indexes.
+ * The keys are pointers to the `path' member of the values.
+ * The capacity of the hashtable is zero until a bundle is first looked up. */
+static hashtable_T bundles;
+
+/* Searches $YASH_LOADPATH for the script file `name' to be autoloaded.
+ * In each directory in $YASH_LOADPATH, the script is looked up in the bundle
+ * first and as a separate file next. Members of a bundle that were older than
+ * the separate files when the bundle index was read are ignored (see
+ * `remove_stale_bundle_members').
+ * If the script is found as a separate file, its pathname is returned and NULL
+ * is assigned to `*codep'. If the script is found in a bundle, the pathname of
+ * the bundle is returned and the contents of the script are assigned to
+ * `*codep'. The returned pathname and the contents are newly malloced.
+ * If the script is not found, NULL is returned. */
+char *search_loadpath(const char *name, wchar_t **codep)
+{
+    *codep = NULL;
+
+    char *const *dirs = get_path_array(PA_LOADPATH);
+    const char *membername = strrchr(name, '/');
+    if (name[0] == '/' || membername == NULL || membername[1] == '\0'
+            || dirs == NULL)
+        return which(name, dirs, is_readable_regular);
+    size_t dirnamelen = membername - name;
+    membername++;
+
+    for (; *dirs != NULL; dirs++) {
+        xstrbuf_T path;
+        sb_init(&path);
+        if ((*dirs)[0] != '\0') {
+            sb_cat(&path, *dirs);
+            if (path.contents[path.length - 1] != '/')
+                sb_ccat(&path, '/');
+        }
+        size_t dirlen = path.length;
+
+        sb_ncat_force(&path, name, dirnamelen);
+        sb_cat(&path, BUNDLE_SUFFIX);
+        const bundle_T *bundle = get_bundle(path.contents);
+        if (bundle != NULL) {
+            const bundlemember_T *member =
+                ht_get(&bundle->members, membername).value;
+            wchar_t *code = (member == NULL) ? NULL
+                : read_bundle_member(bundle, member);
+            if (code != NULL) {
+                sb_destroy(&path);
+                *codep = code;
+                return xstrdup(bundle->path);
+            }
+        }
+
+        sb_truncate(&path, dirlen);
+        sb_cat(&path, name);
+        if (is_readable_regular(path.contents))
+            return sb_tostr(&path);
+        sb_destroy(&path);
+    }
+    return NULL;
+}
+
+/* Returns the index of the bundle file at `path'.
+ * The index is read from the file unless it has been read before and the file
+ * has not been modified since then.
+ * Returns NULL if the file does not exist or is not a valid bundle. */
+const bundle_T *get_bundle(const char *path)
+{
+    if (bundles.capacity == 0)
+        ht_init(&bundles, hashstr, htstrcmp);
+
+    struct stat st;
+    bool exists = stat(path, &st) == 0 && S_ISREG(st.st_mode);
+
+    bundle_T *bundle = ht_get(&bundles, path).value;
+    if (bundle != NULL) {
+        if (exists && is_same_bundle_file(&bundle->stat, &st))
+            return bundle;
+        ht_remove(&bundles, path);
+        free_bundle(bundle);
+    }
+    if (!exists)
+        return NULL;
+
+    bundle = read_bundle(path, &st);
+    if (bundle != NULL)
+        ht_set(&bundles, bundle->path, bundle);
+    return bundle;
+}
+
+/* Reads the bundle file at `path'.
+ * `st' must be the result of `stat'ing the file.
+ * Returns NULL if the file cannot be read or is not a valid bundle. */
+bundle_T *read_bundle(const char *path, const struct stat *st)
+{
+    if (st->st_size <= 0 || (uintmax_t) st->st_size >= SIZE_MAX)
+        return NULL;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+
+    struct stat fst;
+    bool mapped;
+    char *contents;
+    if (fstat(fd, &fst) < 0 || !is_same_bundle_file(st, &fst))
+        contents = NULL;
+    else
+        contents = read_bundle_contents(fd, (size_t) st->st_size, &mapped);
+    xclose(fd);
+    if (contents == NULL)
+        return NULL;
+
+    bundle_T *bundle = xmallocs(sizeof *bundle,
+            add(strlen(path), 1), sizeof *bundle->path);
+    bundle->stat = *st;
+    ht_init(&bundle->members, hashstr, htstrcmp);
+    bundle->contents = contents;
+    bundle->mapped = mapped;
+    strcpy(bundle->path, path);
+
+    if (!read_bundle_index(bundle)) {
+        free_bundle(bundle);
+        return NULL;
+    }
+    remove_stale_bundle_members(bundle);
+    return bundle;
+}
+
+/* Maps the contents of the file `fd' of `size' bytes into memory. If the file
+ * cannot be mapped, the contents are read into a newly malloced buffer instead.
+ * Whether the result is mapped is assigned to `*mappedp'.
+ * Returns NULL if the contents cannot be read. */
+char *read_bundle_contents(int fd, size_t size, bool *mappedp)
+{
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+        *mappedp = true;
+        return map;
+    }
+
+    *mappedp = false;
+    char *buf = xmalloc(size);
+    size_t length = 0;
+    while (length < size) {
+        ssize_t count = read(fd, &buf[length], size - length);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0) {
+            free(buf);
+            return NULL;
+        }
+        length += count;
+    }
+    return buf;
+}
+
+/* Parses the index at the beginning of the contents of the specified bundle
+ * and adds the members to `bundle->members'.
+ * Returns false if the bundle is not valid. */
+bool read_bundle_index(bundle_T *bundle)
+{
+    const char *contents = bundle->contents;
+    size_t size = (size_t) bundle->stat.st_size;
+    size_t magiclen = strlen(BUNDLE_MAGIC);
+    if (size < magiclen || memcmp(contents, BUNDLE_MAGIC, magiclen) != 0)
+        return false;
+
+    /* find the empty line that terminates the index */
+    size_t indexend = magiclen;
+    for (;;) {
+        const char *nl = memchr(&contents[indexend], '\n', size - indexend);
+        if (nl == NULL)
+            return false;
+        if (nl == &contents[indexend])
+            break;
+        indexend = nl - contents + 1;
+    }
+
+    size_t offset = indexend + 1;
+    for (size_t pos = magiclen; pos < indexend; ) {
+        size_t length = 0;
+        if (!isdigit((unsigned char) contents[pos]))
+            return false;
+        while (isdigit((unsigned char) contents[pos])) {
+            size_t digit = (size_t) (contents[pos++] - '0');
+            if (length > (SIZE_MAX - digit) / 10)
+                return false;
+            length = length * 10 + digit;
+        }
+        if (contents[pos++] != ' ' || length > size - offset)
+            return false;
+
+        const char *membername = &contents[pos];
+        const char *end = memchr(membername, '\n', indexend - pos);
+        assert(end != NULL);
+        size_t namelen = end - membername;
+
+        bundlemember_T *member = xmallocs(sizeof *member,
+                add(namelen, 1), sizeof *member->name);
+        member->offset = offset;
+        member->length = length;
+        memcpy(member->name, membername, namelen);
+        member->name[namelen] = '\0';
+        vfree(ht_set(&bundle->members, member->name, member));
+
+        offset += length;
+        pos = end - contents + 1;
+    }
+    return true;
+}
+
+/* Removes the members of the specified bundle that are older than the
+ * corresponding separate script files, so that the separate files are used
+ * instead. This check is done only when the bundle is read; separate files that
+ * are modified after that are not noticed until the bundle is read again. */
+void remove_stale_bundle_members(bundle_T *bundle)
+{
+    xstrbuf_T path;
+    sb_init(&path);
+    sb_ncat_force(&path, bundle->path,
+            strlen(bundle->path) - strlen(BUNDLE_SUFFIX));
+    sb_ccat(&path, '/');
+    size_t dirlen = path.length;
+
+    plist_T stale;
+    pl_init(&stale);
+
+    size_t i = 0;
+    kvpair_T kv;
+    while ((kv = ht_next(&bundle->members, &i)).key != NULL) {
+        struct stat st;
+        sb_truncate(&path, dirlen);
+        sb_cat(&path, kv.key);
+        if (stat(path.contents, &st) == 0 && S_ISREG(st.st_mode)
+                && st.st_mtime > bundle->stat.st_mtime)
+            pl_add(&stale, kv.value);
+    }
+    sb_destroy(&path);
+
+    for (i = 0; i < stale.length; i++) {
+        bundlemember_T *member = stale.contents[i];
+        ht_remove(&bundle->members, member->name);
+        free(member);
+    }
+    pl_destroy(&stale);
+}
+
+/* Frees the specified bundle index. */
+void free_bundle(bundle_T *bundle)
+{
+    ht_destroy(ht_clear(&bundle->members, vfree));
+    if (bundle->mapped)
+        munmap(bundle->contents, (size_t) bundle->stat.st_size);
+    else
+        free(bundle->contents);
+    free(bundle);
+}
+
+/* Checks if the two `stat' results refer to the same unmodified file. */
+bool is_same_bundle_file(const struct stat *st1, const struct stat *st2)
+{
+    return stat_result_same_file(st1, st2)
+        && st1->st_size == st2->st_size
+        && st1->st_mtime == st2->st_mtime;
+}
+
+/* Returns the contents of the specified bundle member as a newly malloced wide
+ * string, or NULL if the contents cannot be converted. */
+wchar_t *read_bundle_member(
+        const bundle_T *bundle, const bundlemember_T *member)
+{
+    char *buf = xmalloce(member->length, 1, sizeof *buf);
+    memcpy(buf, &bundle->contents[member->offset], member->length);
+    buf[member->length] = '\0';
+
+    wchar_t *code = malloc_mbstowcs(buf);
+    free(buf);
+    return code;
+}
+
+
 /********** wglob **********/
 
 /* Parsed glob pattern component */
@@ -654,9 +1267,6 @@ static bool wglob_should_recurse(
 static bool wglob_is_reentry(const struct wglob_stack *const t, size_t count)
     __attribute__((nonnull,pure));
 
-static int wglob_sortcmp(const void *v1, const void *v2)
-    __attribute__((pure,nonnull));
-
 /* A wide string version of `glob'.
  * Adds all pathnames that matches the specified pattern to the specified list.
  * pattern: the pattern to match
@@ -704,7 +1314,7 @@ bool wglob(const wchar_t *restrict pattern, enum wglobflags_T flags,
 
     if (!(flags & WGLB_NOSORT)) {
         size_t count = list->length - listbase;  /* # of resulting items */
-        qsort(list->contents + listbase, count, sizeof (void *), wglob_sortcmp);
+        sort_wcs_by_collation(list->contents + listbase, count);
     }
     return !is_interrupted();
 }
@@ -1124,11 +1734,6 @@ bool wglob_is_reentry(const struct wglob_stack *const t, size_t count)
     return false;
 }
 
-int wglob_sortcmp(const void *v1, const void *v2)
-{
-    return wcscoll(*(const wchar_t *const *) v1, *(const wchar_t *const *) v2);
-}
-
 
 /********** Built-ins **********/
 
@@ -1599,6 +2204,7 @@ int hash_builtin(int argc, void **argv)
         if (remove) {
             if (xoptind == argc) {  // forget all
                 clear_homedirhash();
+                discard_nss_snapshot(NSSDB_PASSWD);
             } else {                // forget the specified
                 for (int i = xoptind; i < argc; i++)
                     forget_home_directory(ARGV(i));
@@ -87,6 +87,32 @@ extern const wchar_t *get_home_directory(
     __attribute__((nonnull));
 
 
+/********** User, Group, and Host Databases **********/
+
+typedef enum nssdb_T {
+    NSSDB_PASSWD, NSSDB_GROUP, NSSDB_HOSTS, NSSDB_COUNT,
+} nssdb_T;
+
+typedef struct nssentry_T {
+    char *name;
+    char *info;  /* GECOS field for users; NULL for others */
+    char *home;  /* home directory for users; NULL for others */
+} nssentry_T;
+
+extern const nssentry_T *get_nss_entries(nssdb_T db, const char *prefix,
+        size_t *countp, _Bool cancelled(void))
+    __attribute__((nonnull(2,3)));
+extern const nssentry_T *find_nss_entry(nssdb_T db, const char *name)
+    __attribute__((nonnull));
+extern void discard_nss_snapshot(nssdb_T db);
+
+
+/********** Script Bundles **********/
+
+extern char *search_loadpath(const char *name, wchar_t **codep)
+    __attribute__((nonnull,malloc,warn_unused_result));
+
+
 /********** wglob **********/
 
 enum wglobflags_T {
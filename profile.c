@@ -0,0 +1,397 @@
+/* Yash: yet another shell */
+/* profile.c: script profiler */
+/* (C) 2026 magicant */
+
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+
+#include "common.h"
+#include "profile.h"
+#include <assert.h>
+#include <errno.h>
+#if HAVE_GETTEXT
+# include <libintl.h>
+#endif
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#include "builtin.h"
+#include "exec.h"
+#include "hashtable.h"
+#include "strbuf.h"
+#include "util.h"
+
+
+/* The profiler is active while the "profiling" option is on. The hooks in
+ * exec.c check the option before calling the functions in this file, so the
+ * overhead of the profiler is a single branch when it is inactive.
+ *
+ * The profiler measures two kinds of frames: function frames and line frames.
+ * A function frame covers the execution of a function body. A line frame
+ * covers the execution of an and-or list and is labeled "name:lineno", where
+ * "name" is the name of the innermost function being executed or "main" and
+ * "lineno" is the line number of the and-or list.
+ * For each function and each label, the number of executions, the inclusive
+ * and exclusive wall-clock and CPU times and the number of forks are
+ * accumulated. The exclusive wall-clock time is also accumulated for each
+ * stack of line frames, which can be written in the folded-stack format that
+ * flame graph tools accept. */
+
+/* Statistics for a function, a line or a stack of lines. */
+typedef struct profstat_T {
+    unsigned long count;           /* number of executions */
+    unsigned long forks, selfforks;/* number of forked child processes */
+    double wall, selfwall;         /* wall-clock time in seconds */
+    double cpu, selfcpu;           /* CPU time in seconds */
+} profstat_T;
+
+/* A frame being executed. */
+typedef struct profframe_T {
+    profstat_T *stat;       /* statistics of the function or line */
+    profstat_T *stackstat;  /* statistics of the stack (NULL for a function) */
+    const wchar_t *name;    /* function name or stack of the frame */
+    double startwall, startcpu;
+    double childwall, childcpu;
+    unsigned long startforks, childforks;
+} profframe_T;
+
+/* The number of processes forked by the shell. */
+unsigned long profile_fork_count = 0;
+
+/* Hashtables from names (wchar_t *) to statistics (profstat_T *).
+ * `funcstats' contains function names, `linestats' line labels and
+ * `stackstats' stacks of line labels separated by semicolons.
+ * Entries are never removed from the hashtables because the names are referred
+ * to by frames in `frames'. */
+static hashtable_T funcstats, linestats, stackstats;
+
+/* The stack of frames being executed. */
+static profframe_T *frames = NULL;
+static size_t framecount = 0, framemax = 0;
+
+/* The innermost function frame, or NULL if not in a function. */
+static const profframe_T *current_function_frame(void)
+    __attribute__((pure));
+static profstat_T *get_stat(hashtable_T *table, wchar_t *name,
+        const wchar_t **keyp)
+    __attribute__((nonnull));
+static void push_frame(profstat_T *stat, profstat_T *stackstat,
+        const wchar_t *name)
+    __attribute__((nonnull(1,3)));
+static void pop_frame(void);
+static void clear_stats(hashtable_T *table)
+    __attribute__((nonnull));
+static int compare_stats(const void *p1, const void *p2)
+    __attribute__((nonnull,pure));
+static bool print_stats(const hashtable_T *table, const char *title);
+static int write_folded_stacks(const wchar_t *filename)
+    __attribute__((nonnull));
+
+
+const profframe_T *current_function_frame(void)
+{
+    for (size_t i = framecount; i-- > 0; )
+        if (frames[i].stackstat == NULL)
+            return &frames[i];
+    return NULL;
+}
+
+/* Returns the statistics for the specified name in the specified table.
+ * A new zero-cleared entry is added if there is none. `name' must be a
+ * malloced string; it is used as the key of a new entry or freed in this
+ * function. The key in the table is assigned to `*keyp'. */
+profstat_T *get_stat(hashtable_T *table, wchar_t *name, const wchar_t **keyp)
+{
+    if (table->capacity == 0)
+        ht_init(table, hashwcs, htwcscmp);
+
+    kvpair_T kv = ht_get(table, name);
+    if (kv.key != NULL) {
+        free(name);
+    } else {
+        profstat_T *stat = xmalloc(sizeof *stat);
+        *stat = (profstat_T) { .count = 0, };
+        ht_set(table, name, stat);
+        kv.key = name, kv.value = stat;
+    }
+    *keyp = kv.key;
+    return kv.value;
+}
+
+void push_frame(profstat_T *stat, profstat_T *stackstat, const wchar_t *name)
+{
+    if (framecount == framemax) {
+        framemax = add(mul(framemax, 2), 8);
+        frames = xreallocn(frames, framemax, sizeof *frames);
+    }
+    frames[framecount++] = (profframe_T) {
+        .stat = stat,
+        .stackstat = stackstat,
+        .name = name,
+        .startwall = monotonic_time(),
+        .startcpu = process_cpu_time(),
+        .childwall = 0.0,
+        .childcpu = 0.0,
+        .startforks = profile_fork_count,
+        .childforks = 0,
+    };
+}
+
+/* Pops the innermost frame and adds its measurements to the statistics and
+ * the parent frame. The exclusive measurements of a function frame exclude
+ * nested function calls only, and those of a line frame exclude nested line
+ * frames only. */
+void pop_frame(void)
+{
+    assert(framecount > 0);
+
+    profframe_T *f = &frames[--framecount];
+    double wall = monotonic_time() - f->startwall;
+    double cpu = process_cpu_time() - f->startcpu;
+    unsigned long forks = profile_fork_count - f->startforks;
+
+    f->stat->count++;
+    f->stat->wall += wall;
+    f->stat->selfwall += wall - f->childwall;
+    f->stat->cpu += cpu;
+    f->stat->selfcpu += cpu - f->childcpu;
+    f->stat->forks += forks;
+    f->stat->selfforks += forks - f->childforks;
+    if (f->stackstat != NULL) {
+        f->stackstat->count++;
+        f->stackstat->selfwall += wall - f->childwall;
+    }
+
+    /* The parent is the innermost frame of the same kind. */
+    for (size_t i = framecount; i-- > 0; ) {
+        profframe_T *parent = &frames[i];
+        if ((parent->stackstat == NULL) == (f->stackstat == NULL)) {
+            parent->childwall += wall;
+            parent->childcpu += cpu;
+            parent->childforks += forks;
+            break;
+        }
+    }
+}
+
+/* Starts measuring the execution of the function of the specified name. */
+void profile_enter_function(const wchar_t *name)
+{
+    const wchar_t *key;
+    profstat_T *stat = get_stat(&funcstats, xwcsdup(name), &key);
+    push_frame(stat, NULL, key);
+}
+
+/* Finishes measuring the innermost function. */
+void profile_leave_function(void)
+{
+    assert(framecount > 0 && frames[framecount - 1].stackstat == NULL);
+    pop_frame();
+}
+
+/* Starts measuring the execution of the and-or list at the specified line. */
+void profile_enter_line(unsigned long lineno)
+{
+    const profframe_T *func = current_function_frame();
+    const wchar_t *funcname = (func != NULL) ? func->name : L"main";
+
+    const wchar_t *label;
+    profstat_T *stat = get_stat(&linestats,
+            malloc_wprintf(L"%ls:%lu", funcname, lineno), &label);
+
+    const profframe_T *parent = NULL;
+    for (size_t i = framecount; i-- > 0; ) {
+        if (frames[i].stackstat != NULL) {
+            parent = &frames[i];
+            break;
+        }
+    }
+
+    const wchar_t *stack;
+    profstat_T *stackstat = get_stat(&stackstats, (parent == NULL)
+            ? xwcsdup(label) : malloc_wprintf(L"%ls;%ls", parent->name, label),
+            &stack);
+    push_frame(stat, stackstat, stack);
+}
+
+/* Finishes measuring the innermost and-or list. */
+void profile_leave_line(void)
+{
+    assert(framecount > 0 && frames[framecount - 1].stackstat != NULL);
+    pop_frame();
+}
+
+/* Resets all the statistics in the specified table to zero. */
+void clear_stats(hashtable_T *table)
+{
+    size_t index = 0;
+    kvpair_T kv;
+    while ((kv = ht_next(table, &index)).key != NULL)
+        *(profstat_T *) kv.value = (profstat_T) { .count = 0, };
+}
+
+/* Compares two statistics (kvpair_T) by the exclusive wall-clock time in
+ * descending order. Ties are broken by the names. */
+int compare_stats(const void *p1, const void *p2)
+{
+    const kvpair_T *kv1 = p1, *kv2 = p2;
+    const profstat_T *s1 = kv1->value, *s2 = kv2->value;
+    if (s1->selfwall > s2->selfwall)
+        return -1;
+    if (s1->selfwall < s2->selfwall)
+        return 1;
+    return wcscmp(kv1->key, kv2->key);
+}
+
+/* Prints the statistics in the specified table to the standard output.
+ * Entries that have never been executed are omitted.
+ * Returns true iff successful. */
+bool print_stats(const hashtable_T *table, const char *title)
+{
+    if (!xprintf("%-10s %10s %12s %12s %12s %12s %8s %8s\n", title, "calls",
+                "total(ms)", "self(ms)", "cpu(ms)", "selfcpu(ms)",
+                "forks", "selfforks"))
+        return false;
+    if (table->capacity == 0)
+        return true;
+
+    kvpair_T *kvs = ht_tokvarray(table);
+    qsort(kvs, table->count, sizeof *kvs, compare_stats);
+
+    bool ok = true;
+    for (size_t i = 0; ok && i < table->count; i++) {
+        const profstat_T *s = kvs[i].value;
+        if (s->count == 0)
+            continue;
+        ok = xprintf("%-10ls %10lu %12.3f %12.3f %12.3f %12.3f %8lu %8lu\n",
+                (const wchar_t *) kvs[i].key, s->count,
+                s->wall * 1e3, s->selfwall * 1e3,
+                s->cpu * 1e3, s->selfcpu * 1e3,
+                s->forks, s->selfforks);
+    }
+    free(kvs);
+    return ok;
+}
+
+/* Writes the exclusive wall-clock time of each stack of lines in the folded-
+ * stack format, one line per stack. The time is in microseconds.
+ * If `filename' is "-", the standard output is used. */
+int write_folded_stacks(const wchar_t *filename)
+{
+    FILE *f;
+
+    if (wcscmp(filename, L"-") == 0) {
+        f = stdout;
+    } else {
+        char *mbsfilename = malloc_wcstombs(filename);
+        if (mbsfilename == NULL)
+            goto error;
+        f = fopen(mbsfilename, "w");
+        free(mbsfilename);
+        if (f == NULL)
+            goto error;
+    }
+
+    size_t index = 0;
+    kvpair_T kv;
+    while ((kv = ht_next(&stackstats, &index)).key != NULL) {
+        const profstat_T *s = kv.value;
+        if (s->count == 0)
+            continue;
+
+        char *stack = malloc_wcstombs(kv.key);
+        if (stack == NULL)
+            continue;
+        fprintf(f, "%s %.0f\n", stack, s->selfwall * 1e6);
+        free(stack);
+    }
+
+    if (f == stdout) {
+        if (fflush(f) != 0)
+            goto error;
+    } else {
+        if (fclose(f) != 0)
+            goto error;
+    }
+    return Exit_SUCCESS;
+
+error:
+    xerror(errno, Ngt("cannot write the profile to file `%ls'"), filename);
+    return Exit_FAILURE;
+}
+
+/* The "profile" built-in, which accepts the following options:
+ *  -c: clear the statistics
+ *  -w file: write the stacks in the folded-stack format to the file
+ * Without options, the statistics are printed in a table. */
+int profile_builtin(int argc, void **argv)
+{
+    bool hasoption = false;
+
+    const struct xgetopt_T *opt;
+    xoptind = 0;
+    while ((opt = xgetopt(argv, profile_options, 0)) != NULL) {
+        hasoption = true;
+        switch (opt->shortopt) {
+            case L'c':
+                clear_stats(&funcstats);
+                clear_stats(&linestats);
+                clear_stats(&stackstats);
+                break;
+            case L'w':
+                if (write_folded_stacks(xoptarg) != Exit_SUCCESS)
+                    return Exit_FAILURE;
+                break;
+#if YASH_ENABLE_HELP
+            case L'-':
+                return print_builtin_help(ARGV(0));
+#endif
+            default:
+                return Exit_ERROR;
+        }
+    }
+
+    if (!validate_operand_count(argc - xoptind, 0, 0))
+        return Exit_ERROR;
+    if (hasoption)
+        return Exit_SUCCESS;
+
+    if (!print_stats(&funcstats, "FUNCTION") || !xprintf("\n")
+            || !print_stats(&linestats, "LINE"))
+        return Exit_FAILURE;
+    return Exit_SUCCESS;
+}
+
+#if YASH_ENABLE_HELP
+const char profile_help[] = Ngt(
+"print or write profiling statistics"
+);
+const char profile_syntax[] = Ngt(
+"\tprofile [-c] [-w file]\n"
+);
+#endif
+
+const struct xgetopt_T profile_options[] = {
+    { L'c', L"clear", OPTARG_NONE,     true,  NULL, },
+    { L'w', L"write", OPTARG_REQUIRED, true,  NULL, },
+#if YASH_ENABLE_HELP
+    { L'-', L"help",  OPTARG_NONE,     false, NULL, },
+#endif
+    { L'\0', NULL, 0, false, NULL, },
+};
+
+
+/* vim: set ts=8 sts=4 sw=4 et tw=80: */
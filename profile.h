@@ -0,0 +1,45 @@
+/* Yash: yet another shell */
+/* profile.h: script profiler */
+/* (C) 2026 magicant */
+
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+
+#ifndef YASH_PROFILE_H
+#define YASH_PROFILE_H
+
+#include <stddef.h>
+#include "xgetopt.h"
+
+
+extern unsigned long profile_fork_count;
+
+extern void profile_enter_function(const wchar_t *name)
+    __attribute__((nonnull));
+extern void profile_leave_function(void);
+extern void profile_enter_line(unsigned long lineno);
+extern void profile_leave_line(void);
+
+extern int profile_builtin(int argc, void **argv)
+    __attribute__((nonnull));
+#if YASH_ENABLE_HELP
+extern const char profile_help[], profile_syntax[];
+#endif
+extern const struct xgetopt_T profile_options[];
+
+
+#endif /* YASH_PROFILE_H */
+
+
+/* vim: set ts=8 sts=4 sw=4 et tw=80: */
@@ -28,12 +28,12 @@
 #include <limits.h>
 #if YASH_ENABLE_SOCKET
 # include <netdb.h>
+# include <poll.h>
 #endif
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/select.h>
 #if YASH_ENABLE_SOCKET
 # include <sys/socket.h>
 #endif
@@ -48,8 +48,13 @@
 #include "sig.h"
 #include "strbuf.h"
 #include "util.h"
+#include "variable.h"
 #include "yash.h"
 
+#if HAVE_CLOSE_RANGE && !defined(close_range)
+extern int close_range(unsigned int first, unsigned int last, int flags);
+#endif
+
 
 /********** Utilities **********/
 
@@ -114,12 +119,19 @@ bool write_all(int fd, const void *data, size_t size)
 
 /********** Shell FDs **********/
 
-static void reset_shellfdmin(void);
+static inline bool shellfds_contains(int fd)
+    __attribute__((pure));
+static void close_shellfd_range(int first, int last);
+static void forget_all_saved_copies(void);
 
 
 /* Set of file descriptors used by the shell.
- * These file descriptors cannot be used by the user. */
-static fd_set shellfds;
+ * These file descriptors cannot be used by the user.
+ * The set is a bitmap of `shellfdwords' words, which is extended as needed so
+ * that file descriptors of any number can be tracked. */
+static unsigned long *shellfds = NULL;
+static size_t shellfdwords = 0;
+#define SHELLFD_BITS (CHAR_BIT * sizeof *shellfds)
 /* The minimum file descriptor that can be used for shell FD. */
 static int shellfdmin;
 /* The maximum file descriptor in `shellfds'.
@@ -146,7 +158,6 @@ void init_shellfds(void)
     initialized = true;
 #endif
 
-    FD_ZERO(&shellfds);
     reset_shellfdmin();
     assert(shellfdmax == -1);  // shellfdmax = -1;
 }
@@ -162,8 +173,6 @@ void reset_shellfdmin(void)
         else
             shellfdmin = SHELLFDMINMAX;
     } else {
-        if (shellfdmin > FD_SETSIZE)
-            shellfdmin = FD_SETSIZE;
         shellfdmin /= 2;
         if (shellfdmin > SHELLFDMINMAX)
             shellfdmin = SHELLFDMINMAX;
@@ -172,12 +181,30 @@ void reset_shellfdmin(void)
     }
 }
 
+/* Checks if the bit for the specified file descriptor is set in `shellfds'. */
+bool shellfds_contains(int fd)
+{
+    size_t index = (size_t) fd / SHELLFD_BITS;
+    return index < shellfdwords
+        && (shellfds[index] >> ((size_t) fd % SHELLFD_BITS) & 1);
+}
+
 /* Adds the specified file descriptor (>= `shellfdmin') to `shellfds'. */
 void add_shellfd(int fd)
 {
     assert(fd >= shellfdmin);
-    if (fd < FD_SETSIZE)
-        FD_SET(fd, &shellfds);
+
+    size_t index = (size_t) fd / SHELLFD_BITS;
+    if (index >= shellfdwords) {
+        size_t newwords = index + 1;
+        if (newwords < shellfdwords * 2)
+            newwords = shellfdwords * 2;
+        shellfds = xreallocn(shellfds, newwords, sizeof *shellfds);
+        memset(&shellfds[shellfdwords], 0,
+                (newwords - shellfdwords) * sizeof *shellfds);
+        shellfdwords = newwords;
+    }
+    shellfds[index] |= 1UL << ((size_t) fd % SHELLFD_BITS);
     if (shellfdmax < fd)
         shellfdmax = fd;
 }
@@ -186,21 +213,24 @@ void add_shellfd(int fd)
  * Must be called BEFORE `xclose(fd)'. */
 void remove_shellfd(int fd)
 {
-    if (0 <= fd && fd < FD_SETSIZE)
-        FD_CLR(fd, &shellfds);
+    if (!shellfds_contains(fd))
+        return;
+    shellfds[(size_t) fd / SHELLFD_BITS] &=
+        ~(1UL << ((size_t) fd % SHELLFD_BITS));
     if (fd == shellfdmax) {
         do
             shellfdmax--;
-        while (shellfdmax >= 0 && !FD_ISSET(shellfdmax, &shellfds));
+        while (shellfdmax >= 0 && !shellfds_contains(shellfdmax));
     }
 }
-/* The argument to `FD_CLR' must be a valid (open) file descriptor. This is why
- * `remove_shellfd' must be called before closing the file descriptor. */
+/* `remove_shellfd' must be called before closing the file descriptor so that
+ * the number is not reused by another file descriptor while it is still in
+ * `shellfds'. */
 
 /* Checks if the specified file descriptor is in `shellfds'. */
 bool is_shellfd(int fd)
 {
-    return fd >= FD_SETSIZE || (fd >= 0 && FD_ISSET(fd, &shellfds));
+    return fd >= 0 && shellfds_contains(fd);
 }
 
 /* Clears `shellfds'.
@@ -208,15 +238,37 @@ bool is_shellfd(int fd)
 void clear_shellfds(bool leavefds)
 {
     if (!leavefds) {
-        for (int fd = 0; fd <= shellfdmax; fd++)
-            if (FD_ISSET(fd, &shellfds))
-                xclose(fd);
-        FD_ZERO(&shellfds);
+        /* close each run of consecutive shell FDs at once */
+        for (int fd = 0; fd <= shellfdmax; fd++) {
+            if (!shellfds_contains(fd))
+                continue;
+            int last = fd;
+            while (last < shellfdmax && shellfds_contains(last + 1))
+                last++;
+            close_shellfd_range(fd, last);
+            fd = last;
+        }
+        if (shellfdwords > 0)
+            memset(shellfds, 0, shellfdwords * sizeof *shellfds);
         shellfdmax = -1;
+        forget_all_saved_copies();
     }
     ttyfd = -1;
 }
 
+/* Closes the file descriptors from `first' to `last' (inclusive).
+ * If available, `close_range' is used to close them in one system call. */
+void close_shellfd_range(int first, int last)
+{
+#if HAVE_CLOSE_RANGE
+    if (close_range((unsigned) first, (unsigned) last, 0) == 0)
+        return;
+    /* fall back on `close' if the kernel does not support `close_range' */
+#endif
+    for (int fd = first; fd <= last; fd++)
+        xclose(fd);
+}
+
 /* Duplicates the specified file descriptor as a new shell FD.
  * The new FD is added to `shellfds'.
  * On error, `errno' is set and -1 is returned. */
@@ -288,23 +340,61 @@ struct savefd_T {
     struct savefd_T *next;
     int  sf_origfd;            /* original file descriptor */
     int  sf_copyfd;            /* copied file descriptor */
+    struct input_file_info_T *sf_stdininfo;
+};
+/* If `sf_origfd' is negative, the entry was made by `open_virtual_stdin' and
+ * `sf_stdininfo' is the original value of `stdin_input_file_info'. */
+
+/* Copies of file descriptors that were saved by redirections and have been
+ * kept open after the redirections were undone. When the same file descriptor
+ * is redirected again, the copy is reused instead of copying the file
+ * descriptor again, so a redirection in a loop costs fewer system calls.
+ * `savedcopies[fd]' is a shell FD referring to the same open file description
+ * as `fd', or -1 if there is no such copy. Only file descriptors less than
+ * SAVEDCOPIES_MAX are cached. */
+#define SAVEDCOPIES_MAX 10
+static int savedcopies[SAVEDCOPIES_MAX] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
 };
 
+static bool open_redirections_virtually(
+        const redir_T *r, savefd_T **save, const redir_T *virtualstdin)
+    __attribute__((nonnull(2)));
+static const redir_T *find_virtualizable_stdin(const redir_T *r)
+    __attribute__((pure));
+static bool open_virtual_stdin(const redir_T *r, savefd_T **save)
+    __attribute__((nonnull));
 static char *expand_redir_filename(const struct wordunit_T *filename)
     __attribute__((malloc,warn_unused_result));
 static void save_fd(int oldfd, savefd_T **save)
     __attribute__((nonnull));
+static int take_saved_copy(int fd);
+static void keep_saved_copy(int fd, int copyfd);
+static void forget_saved_copy(int fd);
+static void release_saved_copy(int copyfd);
 static int open_file(const char *path, int oflag)
     __attribute__((nonnull));
 #if YASH_ENABLE_SOCKET
 static int open_socket(const char *hostandport, int socktype)
     __attribute__((nonnull));
+static struct addrinfo *resolve_socket_address(
+        const char *hostandport, int socktype)
+    __attribute__((nonnull));
+static struct addrinfo *getaddrinfo_hostandport(
+        const char *hostandport, int socktype)
+    __attribute__((nonnull));
+static int connect_socket(const struct addrinfo *ai)
+    __attribute__((nonnull));
+static int start_connect(const struct addrinfo *ai);
+static double get_connect_timeout(void);
 #endif
 static int parse_and_check_dup(char *num, redirtype_T type)
     __attribute__((nonnull));
 static int parse_and_exec_pipe(int outputfd, char *num, savefd_T **save)
     __attribute__((nonnull));
 static int open_heredocument(const struct wordunit_T *content);
+static char *expand_heredocument(const struct wordunit_T *contents)
+    __attribute__((malloc,warn_unused_result));
 static int open_herestring(char *s, bool appendnewline)
     __attribute__((nonnull));
 static int open_process_redirection(const embedcmd_T *command, redirtype_T type)
@@ -316,10 +406,39 @@ static int open_process_redirection(const embedcmd_T *command, redirtype_T type)
  * to `*save' (whether successful or not).
  * Returns true iff successful. */
 bool open_redirections(const redir_T *r, savefd_T **save)
+{
+    return open_redirections_virtually(r, save, NULL);
+}
+
+/* Opens redirections like `open_redirections', but if the standard input is
+ * finally redirected to a here-document or here-string, the contents are not
+ * passed through a file descriptor. Instead, `stdin_input_file_info' is
+ * replaced with an in-memory buffer and the standard input FD is left intact.
+ * This saves creating, writing and reading a pipe or temporary file, but can be
+ * used only for a built-in that reads the standard input solely through
+ * `stdin_input_file_info' and does not pass it to another process. */
+bool open_redirections_for_reader(const redir_T *r, savefd_T **save)
+{
+    return open_redirections_virtually(r, save, find_virtualizable_stdin(r));
+}
+
+/* Opens redirections as described for `open_redirections'.
+ * If `virtualstdin' is non-null, it must be a redirection in `r' that is
+ * opened by `open_virtual_stdin'. */
+bool open_redirections_virtually(
+        const redir_T *r, savefd_T **save, const redir_T *virtualstdin)
 {
     *save = NULL;
 
     while (r != NULL) {
+        if (r == virtualstdin) {
+            if (!open_virtual_stdin(r, save))
+                return false;
+            r = r->next;
+            continue;
+        }
+
+        release_saved_copy(r->rd_fd);
         if (r->rd_fd < 0) {
             xerror(0, Ngt("redirection: invalid file descriptor"));
             return false;
@@ -434,6 +553,68 @@ openwithflags:
     return true;
 }
 
+/* Returns the here-document or here-string redirection in `r' that can be
+ * opened by `open_virtual_stdin', or NULL if there is none.
+ * Such a redirection must be the last that redirects the standard input, and
+ * must not be followed by a redirection that may duplicate the standard input.
+ */
+const redir_T *find_virtualizable_stdin(const redir_T *r)
+{
+    const redir_T *result = NULL;
+    for (; r != NULL; r = r->next) {
+        switch (r->rd_type) {
+            case RT_HERE:
+            case RT_HERERT:
+            case RT_HERESTR:
+                if (r->rd_fd == STDIN_FILENO)
+                    result = r;
+                break;
+            case RT_DUPIN:
+            case RT_DUPOUT:
+            case RT_PIPE:
+                result = NULL;
+                break;
+            default:
+                if (r->rd_fd == STDIN_FILENO)
+                    result = NULL;
+                break;
+        }
+    }
+    return result;
+}
+
+/* Makes the contents of the specified here-document or here-string available
+ * through `stdin_input_file_info' without opening a file descriptor.
+ * The original `stdin_input_file_info' is saved in `*save'.
+ * Returns true iff successful. */
+bool open_virtual_stdin(const redir_T *r, savefd_T **save)
+{
+    char *contents;
+    size_t len;
+    if (r->rd_type == RT_HERESTR) {
+        contents = expand_redir_filename(r->rd_filename);
+        if (contents == NULL)
+            return false;
+        len = strlen(contents);
+        contents[len++] = '\n';
+    } else {
+        contents = expand_heredocument(r->rd_herecontent);
+        if (contents == NULL)
+            return false;
+        len = strlen(contents);
+    }
+
+    savefd_T *s = xmalloc(sizeof *s);
+    s->next = *save;
+    s->sf_origfd = s->sf_copyfd = -1;
+    s->sf_stdininfo = stdin_input_file_info;
+    *save = s;
+
+    stdin_input_file_info = new_input_string_info(contents, len);
+    free(contents);
+    return true;
+}
+
 /* Expands the filename for redirection.
  * Returns a newly malloced string or NULL. */
 char *expand_redir_filename(const struct wordunit_T *filename)
@@ -456,21 +637,80 @@ void save_fd(int fd, savefd_T **save)
 {
     assert(fd >= 0);
 
-    int copyfd = copy_as_shellfd(fd);
-    if (copyfd < 0 && errno != EBADF) {
-        xerror(errno, Ngt("cannot save file descriptor %d"), fd);
-        return;
+    flush_xtrace_for(fd);
+
+    int copyfd = take_saved_copy(fd);
+    if (copyfd < 0) {
+        copyfd = copy_as_shellfd(fd);
+        if (copyfd < 0 && errno != EBADF) {
+            xerror(errno, Ngt("cannot save file descriptor %d"), fd);
+            return;
+        }
+        /* If file descriptor `fd' is not open, `copy_as_shellfd' returns -1
+         * with the EBADF errno value. */
     }
-    /* If file descriptor `fd' is not open, `copy_as_shellfd' returns -1 with
-     * the EBADF errno value. */
 
     savefd_T *s = xmalloc(sizeof *s);
     s->next = *save;
     s->sf_origfd = fd;
     s->sf_copyfd = copyfd;
+    s->sf_stdininfo = NULL;
     *save = s;
 }
 
+/* Removes the cached copy of `fd' from `savedcopies' and returns it.
+ * Returns -1 if there is no cached copy. */
+int take_saved_copy(int fd)
+{
+    if (fd >= SAVEDCOPIES_MAX)
+        return -1;
+
+    int copyfd = savedcopies[fd];
+    savedcopies[fd] = -1;
+    return copyfd;
+}
+
+/* Caches `copyfd' as a copy of `fd', which has just been restored from
+ * `copyfd'. If `fd' is too large to cache, `copyfd' is closed. */
+void keep_saved_copy(int fd, int copyfd)
+{
+    if (fd < SAVEDCOPIES_MAX) {
+        forget_saved_copy(fd);
+        savedcopies[fd] = copyfd;
+    } else {
+        remove_shellfd(copyfd);
+        xclose(copyfd);
+    }
+}
+
+/* Closes the cached copy of `fd', if any. This function must be called when
+ * `fd' is closed or changed without being saved. */
+void forget_saved_copy(int fd)
+{
+    int copyfd = take_saved_copy(fd);
+    if (copyfd >= 0) {
+        remove_shellfd(copyfd);
+        xclose(copyfd);
+    }
+}
+
+/* If `copyfd' is a cached copy of a file descriptor, closes it so that the
+ * user can use the file descriptor. */
+void release_saved_copy(int copyfd)
+{
+    for (int fd = 0; fd < SAVEDCOPIES_MAX; fd++)
+        if (savedcopies[fd] == copyfd && copyfd >= 0)
+            forget_saved_copy(fd);
+}
+
+/* Forgets all the cached copies without closing them. This function is called
+ * when the shell FDs are closed in a subshell. */
+void forget_all_saved_copies(void)
+{
+    for (int fd = 0; fd < SAVEDCOPIES_MAX; fd++)
+        savedcopies[fd] = -1;
+}
+
 /* Opens the redirected file.
  * `path' and `oflag' are the first and second arguments to the `open' function.
  * If `oflag' contains the O_EXCL flag, this function may retry without the flag
@@ -481,6 +721,16 @@ void save_fd(int fd, savefd_T **save)
  * -1 is returned. */
 int open_file(const char *path, int oflag)
 {
+    // Support socket redirection.
+#if YASH_ENABLE_SOCKET
+    const char *hostandport = matchstrprefix(path, "/dev/tcp/");
+    if (hostandport != NULL)
+        return open_socket(hostandport, SOCK_STREAM);
+    hostandport = matchstrprefix(path, "/dev/udp/");
+    if (hostandport != NULL)
+        return open_socket(hostandport, SOCK_DGRAM);
+#endif /* YASH_ENABLE_SOCKET */
+
     const mode_t mode =
         S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH;
 
@@ -513,38 +763,106 @@ int open_file(const char *path, int oflag)
         }
     }
 
-    // Support socket redirection.
-#if YASH_ENABLE_SOCKET
-    if (fd < 0) {
-        const char *hostandport = matchstrprefix(path, "/dev/tcp/");
-        if (hostandport != NULL)
-            fd = open_socket(hostandport, SOCK_STREAM);
-    }
-    if (fd < 0) {
-        const char *hostandport = matchstrprefix(path, "/dev/udp/");
-        if (hostandport != NULL)
-            fd = open_socket(hostandport, SOCK_DGRAM);
-    }
-#endif /* YASH_ENABLE_SOCKET */
-
     return fd;
 }
 
 #if YASH_ENABLE_SOCKET
 
+/* The maximum number of entries in `resolvecache'. */
+#define RESOLVECACHE_MAX 8
+/* The number of seconds a resolved address is kept in `resolvecache'. */
+#define RESOLVECACHE_LIFETIME 30.0
+/* The number of seconds to wait before starting a connection attempt to the
+ * next address while the previous attempts are still in progress. */
+#define CONNECT_ATTEMPT_DELAY 0.25
+
+/* Cache of the results of name resolution for socket redirection. */
+static struct resolvecache_T {
+    char *hostandport;         /* NULL if the entry is unused */
+    int socktype;
+    struct addrinfo *ai;
+    double time;               /* when the address was resolved */
+} resolvecache[RESOLVECACHE_MAX];
+
 /* Opens a socket.
  * `hostandport' is the name and the port of the host to connect, concatenated
  * with a slash. `socktype' specifies the type of the socket, which should be
  * SOCK_STREAM for TCP or SOCK_DGRAM for UDP.
- * On failure, returns -1 with `errno' unchanged. */
+ * If the host has more than one address, connections to the addresses are
+ * attempted concurrently and the first successful one is used.
+ * On failure, returns -1 with `errno' set. */
 int open_socket(const char *hostandport, int socktype)
 {
-    struct addrinfo hints, *ai;
-    int err, saveerrno;
-    char *hostname, *port;
     int fd;
 
-    saveerrno = errno;
+    set_interruptible_by_sigint(true);
+
+    const struct addrinfo *ai = resolve_socket_address(hostandport, socktype);
+    if (ai == NULL) {
+        fd = -1;
+        errno = ENOENT;
+    } else {
+        fd = connect_socket(ai);
+    }
+
+    int saveerrno = errno;
+    set_interruptible_by_sigint(false);
+    errno = saveerrno;
+    return fd;
+}
+
+/* Returns the addresses for the specified host and port.
+ * The result may be taken from `resolvecache' and must not be freed by the
+ * caller. It is valid until the next call to this function.
+ * On failure, prints an error message and returns NULL. */
+struct addrinfo *resolve_socket_address(const char *hostandport, int socktype)
+{
+    double now = monotonic_time();
+    struct resolvecache_T *entry = NULL;
+
+    for (size_t i = 0; i < RESOLVECACHE_MAX; i++) {
+        struct resolvecache_T *e = &resolvecache[i];
+        if (e->hostandport != NULL
+                && e->time + RESOLVECACHE_LIFETIME < now) {
+            free(e->hostandport);
+            freeaddrinfo(e->ai);
+            e->hostandport = NULL;
+        }
+        if (e->hostandport == NULL) {
+            if (entry == NULL || entry->hostandport != NULL)
+                entry = e;
+            continue;
+        }
+        if (e->socktype == socktype && strcmp(e->hostandport, hostandport) == 0)
+            return e->ai;
+        if (entry == NULL
+                || (entry->hostandport != NULL && e->time < entry->time))
+            entry = e;
+    }
+
+    struct addrinfo *ai = getaddrinfo_hostandport(hostandport, socktype);
+    if (ai == NULL)
+        return NULL;
+
+    /* Replace an unused or the oldest entry. */
+    if (entry->hostandport != NULL) {
+        free(entry->hostandport);
+        freeaddrinfo(entry->ai);
+    }
+    entry->hostandport = xstrdup(hostandport);
+    entry->socktype = socktype;
+    entry->ai = ai;
+    entry->time = now;
+    return ai;
+}
+
+/* Resolves the specified host and port by calling `getaddrinfo'.
+ * On failure, prints an error message and returns NULL. */
+struct addrinfo *getaddrinfo_hostandport(const char *hostandport, int socktype)
+{
+    struct addrinfo hints, *ai;
+    int err;
+    char *hostname, *port;
 
     /* decompose `hostandport' into `hostname' and `port' */
     {
@@ -552,10 +870,8 @@ int open_socket(const char *hostandport, int socktype)
         const wchar_t *wport;
 
         whostandport = malloc_mbstowcs(hostandport);
-        if (whostandport == NULL) {
-            errno = saveerrno;
-            return -1;
-        }
+        if (whostandport == NULL)
+            return NULL;
         wport = wcschr(whostandport, L'/');
         if (wport != NULL) {
             hostname = malloc_wcsntombs(whostandport, wport - whostandport);
@@ -567,8 +883,6 @@ int open_socket(const char *hostandport, int socktype)
         free(whostandport);
     }
 
-    set_interruptible_by_sigint(true);
-
     hints.ai_flags = 0;
     hints.ai_family = AF_UNSPEC;
     hints.ai_socktype = socktype;
@@ -584,23 +898,169 @@ int open_socket(const char *hostandport, int socktype)
         xerror(0, Ngt("socket redirection: "
                     "cannot resolve the address of `%s': %s"),
                 hostandport, gai_strerror(err));
-        set_interruptible_by_sigint(false);
-        errno = saveerrno;
-        return -1;
+        return NULL;
     }
+    return ai;
+}
 
-    fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
-    if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) < 0) {
-        xclose(fd);
-        fd = -1;
+/* Connects a new socket to one of the specified addresses.
+ * Connection attempts are started in the order of the addresses, alternating
+ * between address families, each `CONNECT_ATTEMPT_DELAY' seconds after the
+ * previous one or immediately after the previous one failed. The first
+ * connection that succeeds is returned and the others are abandoned.
+ * If $YASH_CONNECT_TIMEOUT is set, the whole connection fails with ETIMEDOUT
+ * when no connection succeeds in that many seconds.
+ * On failure, returns -1 with `errno' set. */
+int connect_socket(const struct addrinfo *ai)
+{
+    /* order the addresses alternating between the family of the first address
+     * and the others */
+    size_t count = 0;
+    for (const struct addrinfo *a = ai; a != NULL; a = a->ai_next)
+        count++;
+
+    const struct addrinfo **addrs = xmallocn(count, sizeof *addrs);
+    {
+        const struct addrinfo *first = ai, *second = ai;
+        for (size_t n = 0; n < count; ) {
+            while (first != NULL && first->ai_family != ai->ai_family)
+                first = first->ai_next;
+            if (first != NULL) {
+                addrs[n++] = first;
+                first = first->ai_next;
+            }
+            while (second != NULL && second->ai_family == ai->ai_family)
+                second = second->ai_next;
+            if (second != NULL) {
+                addrs[n++] = second;
+                second = second->ai_next;
+            }
+        }
     }
-    saveerrno = errno;
-    freeaddrinfo(ai);
-    set_interruptible_by_sigint(false);
-    errno = saveerrno;
+
+    struct pollfd *pfds = xmallocn(count, sizeof *pfds);
+    size_t pending = 0, next = 0;
+    double timeout = get_connect_timeout();
+    double now = monotonic_time();
+    double deadline = now + timeout, nextattempt = now;
+    int fd = -1, err = ECONNREFUSED;
+
+    for (;;) {
+        if (next < count && (pending == 0 || now >= nextattempt)) {
+            int newfd = start_connect(addrs[next++]);
+            if (newfd >= 0) {
+                fd = newfd;
+                break;
+            } else if (newfd == -1) {
+                err = errno;
+                if (err == EINTR)
+                    break;
+            } else {
+                pfds[pending].fd = -newfd - 2;
+                pfds[pending].events = POLLOUT;
+                pending++;
+                nextattempt = now + CONNECT_ATTEMPT_DELAY;
+            }
+            continue;
+        }
+        if (pending == 0)
+            break;
+
+        double wait = -1.0;
+        if (next < count)
+            wait = nextattempt - now;
+        if (timeout > 0.0 && (wait < 0.0 || deadline - now < wait))
+            wait = deadline - now;
+        if (timeout > 0.0 && wait <= 0.0) {
+            err = ETIMEDOUT;
+            break;
+        }
+
+        if (wait > INT_MAX / 1000)
+            wait = INT_MAX / 1000;
+        int r = poll(pfds, pending,
+                wait < 0.0 ? -1 : (int) (wait * 1000.0) + 1);
+        if (r < 0) {
+            err = errno;
+            break;
+        }
+        now = monotonic_time();
+        for (size_t i = 0; i < pending; ) {
+            if (pfds[i].revents == 0) {
+                i++;
+                continue;
+            }
+
+            int sockerr;
+            socklen_t len = sizeof sockerr;
+            if (getsockopt(pfds[i].fd, SOL_SOCKET, SO_ERROR, &sockerr, &len)
+                    < 0)
+                sockerr = errno;
+            if (sockerr == 0) {
+                fd = pfds[i].fd;
+                pfds[i] = pfds[--pending];
+                goto done;
+            }
+            err = sockerr;
+            xclose(pfds[i].fd);
+            pfds[i] = pfds[--pending];
+            nextattempt = now;
+        }
+    }
+done:
+    for (size_t i = 0; i < pending; i++)
+        xclose(pfds[i].fd);
+    free(pfds);
+    free(addrs);
+
+    if (fd < 0) {
+        errno = err;
+        return -1;
+    }
+
+    int flags = fcntl(fd, F_GETFL);
+    if (flags >= 0)
+        fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
     return fd;
 }
 
+/* Creates a non-blocking socket and starts connecting it to the specified
+ * address.
+ * If connected immediately, returns the (non-negative) file descriptor.
+ * If the connection is in progress, returns `-fd - 2'.
+ * On failure, returns -1 with `errno' set. */
+int start_connect(const struct addrinfo *ai)
+{
+    int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+    if (fd < 0)
+        return -1;
+
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+        goto fail;
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0)
+        return fd;
+    if (errno == EINPROGRESS)
+        return -fd - 2;
+
+fail:;
+    int saveerrno = errno;
+    xclose(fd);
+    errno = saveerrno;
+    return -1;
+}
+
+/* Returns the value of $YASH_CONNECT_TIMEOUT in seconds, or zero if the
+ * variable is not set to a positive integer. */
+double get_connect_timeout(void)
+{
+    const wchar_t *value = getvar(L VAR_YASH_CONNECT_TIMEOUT);
+    unsigned long timeout;
+    if (value == NULL || !xwcstoul(value, 10, &timeout))
+        return 0.0;
+    return (double) timeout;
+}
+
 #endif /* YASH_ENABLE_SOCKET */
 
 /* Parses the argument to an RT_DUPIN/RT_DUPOUT redirection.
@@ -630,6 +1090,7 @@ int parse_and_check_dup(char *const num, redirtype_T type)
         goto end;
     }
 
+    release_saved_copy(fd);
     if (is_shellfd(fd)) {
         xerror(0, Ngt("redirection: file descriptor %d is unavailable"), fd);
         fd = -2;
@@ -694,6 +1155,8 @@ int parse_and_exec_pipe(int outputfd, char *num, savefd_T **save)
         if (xstrtoi(num, 10, &inputfd) && inputfd < 0)
             errno = ERANGE;
     }
+    if (errno == 0)
+        release_saved_copy(inputfd);
     if (errno != 0) {
         xerror(errno, Ngt("redirection: %s"), num);
         fd = -1;
@@ -752,19 +1215,27 @@ error:
 /* The contents of the here-document is passed either through a pipe or a
  * temporary file. */
 int open_heredocument(const wordunit_T *contents)
+{
+    char *mcontents = expand_heredocument(contents);
+    if (mcontents == NULL)
+        return -1;
+
+    return open_herestring(mcontents, false);
+}
+
+/* Expands the contents of a here-document.
+ * Returns a newly malloced multibyte string, or NULL on error. */
+char *expand_heredocument(const wordunit_T *contents)
 {
     wchar_t *wcontents = expand_single(contents, TT_NONE, Q_INDQ, ES_NONE);
     if (wcontents == NULL)
-        return -1;
+        return NULL;
 
     char *mcontents = realloc_wcstombs(wcontents);
-    if (mcontents == NULL) {
+    if (mcontents == NULL)
         xerror(EILSEQ, Ngt("cannot write the here-document contents "
                     "to the temporary file"));
-        return -1;
-    }
-
-    return open_herestring(mcontents, false);
+    return mcontents;
 }
 
 /* Opens a here-string whose contents is specified by the argument.
@@ -887,12 +1358,18 @@ int open_process_redirection(const embedcmd_T *command, redirtype_T type)
 void undo_redirections(savefd_T *save)
 {
     while (save != NULL) {
-        if (save->sf_copyfd >= 0) {
-            remove_shellfd(save->sf_copyfd);
-            xdup2(save->sf_copyfd, save->sf_origfd);
-            xclose(save->sf_copyfd);
+        if (save->sf_origfd < 0) {
+            free(stdin_input_file_info);
+            stdin_input_file_info = save->sf_stdininfo;
         } else {
-            xclose(save->sf_origfd);
+            flush_xtrace_for(save->sf_origfd);
+            if (save->sf_copyfd >= 0) {
+                xdup2(save->sf_copyfd, save->sf_origfd);
+                keep_saved_copy(save->sf_origfd, save->sf_copyfd);
+            } else {
+                forget_saved_copy(save->sf_origfd);
+                xclose(save->sf_origfd);
+            }
         }
 
         savefd_T *next = save->next;
@@ -902,13 +1379,20 @@ void undo_redirections(savefd_T *save)
 }
 
 /* Frees the FD-saving info without restoring FD.
- * The copied FDs are closed. */
+ * The copied FDs are closed. A virtual standard input made by
+ * `open_virtual_stdin' is discarded. */
 void clear_savefd(savefd_T *save)
 {
     while (save != NULL) {
-        if (save->sf_copyfd >= 0) {
-            remove_shellfd(save->sf_copyfd);
-            xclose(save->sf_copyfd);
+        if (save->sf_origfd < 0) {
+            free(stdin_input_file_info);
+            stdin_input_file_info = save->sf_stdininfo;
+        } else {
+            flush_xtrace_for(save->sf_origfd);
+            if (save->sf_copyfd >= 0) {
+                remove_shellfd(save->sf_copyfd);
+                xclose(save->sf_copyfd);
+            }
         }
 
         savefd_T *next = save->next;
@@ -30,6 +30,7 @@ extern _Bool write_all(int fd, const void *data, size_t size)
 extern int ttyfd;
 
 extern void init_shellfds(void);
+extern void reset_shellfdmin(void);
 extern void add_shellfd(int fd);
 extern void remove_shellfd(int fd);
 extern _Bool is_shellfd(int fd)
@@ -44,6 +45,9 @@ struct redir_T;
 
 extern _Bool open_redirections(const struct redir_T *r, savefd_T **save)
     __attribute__((nonnull(2)));
+extern _Bool open_redirections_for_reader(
+        const struct redir_T *r, savefd_T **save)
+    __attribute__((nonnull(2)));
 extern void undo_redirections(savefd_T *save);
 extern void clear_savefd(savefd_T *save);
 extern void maybe_redirect_stdin_to_devnull(void);
@@ -28,7 +28,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/select.h>
+#if HAVE_PPOLL
+# include <poll.h>
+#else
+# include <sys/select.h>
+#endif
+#include <time.h>
 #include <wchar.h>
 #include <wctype.h>
 #if HAVE_GETTEXT
@@ -52,6 +57,11 @@
 # include "lineedit/lineedit.h"
 #endif
 
+#if HAVE_PPOLL && !defined(ppoll)
+extern int ppoll(struct pollfd *fds, nfds_t nfds,
+        const struct timespec *timeout, const sigset_t *sigmask);
+#endif
+
 
 /* About the shell's signal handling:
  *
@@ -614,7 +624,68 @@ int wait_for_sigchld(bool interruptible, bool return_on_trap)
     return result;
 }
 
+#if HAVE_PIDFD_OPEN
+
+/* Waits for any of the processes referred to by the specified pidfds to
+ * terminate.
+ * Unlike `wait_for_sigchld', SIGCHLD is kept blocked while waiting, so the
+ * shell is not woken up by other child processes. The pending SIGCHLD is
+ * handled later as usual. If SIGCHLD is trapped and `return_on_trap' is true,
+ * however, SIGCHLD is accepted so that the trap is not delayed.
+ * `pfds' is an array of `count' pollfd structures whose `events' should be
+ * POLLIN. When this function returns zero, the `revents' members indicate
+ * which processes have terminated.
+ * If `interruptible' is true, this function can be canceled by SIGINT.
+ * If `return_on_trap' is true, this function returns immediately after a trap
+ * is handled. Otherwise, traps are not handled.
+ * Returns the signal number if interrupted, zero if successful, or -1 on
+ * error. */
+int wait_for_pidfds(struct pollfd *pfds, size_t count,
+        bool interruptible, bool return_on_trap)
+{
+    int result = 0;
+
+    sigset_t ss = accept_sigmask;
+    if (return_on_trap && sigismember(&trapped_signals, SIGCHLD))
+        sigdelset(&ss, SIGCHLD);
+    else
+        sigaddset(&ss, SIGCHLD);
+    if (interruptible)
+        sigdelset(&ss, SIGINT);
+
+    for (;;) {
+        if (return_on_trap && ((result = handle_traps()) != 0))
+            break;
+        if (interruptible && sigint_received)
+            break;
+        if (ppoll(pfds, count, NULL, &ss) > 0)
+            break;
+        if (errno != EINTR) {
+            xerror(errno, "ppoll");
+            return -1;
+        }
+    }
+
+    if (interruptible && sigint_received)
+        result = SIGINT;
+    return result;
+}
+
+#endif /* HAVE_PIDFD_OPEN */
+
 /* Waits for the specified file descriptor to be available for reading.
+ * This is a shorthand for `wait_for_inputs' with a single file descriptor. */
+enum wait_for_input_T wait_for_input(int fd, bool trap, int timeout)
+{
+    bool ready;
+    return wait_for_inputs(&fd, &ready, 1, trap, timeout);
+}
+
+/* Waits for any of the specified file descriptors to be available for reading.
+ * `fds' is an array of `count' file descriptors. When this function returns
+ * W_READY, each element of `ready' is set to indicate whether the
+ * corresponding file descriptor is ready. (A file descriptor is considered
+ * ready also when it has reached the end of file or an error.)
  * `handle_sigchld' and `handle_sigwinch' are called to handle SIGCHLD and
  * SIGWINCH that are caught while waiting.
  * If `trap' is true, traps are also handled while waiting and the
@@ -625,18 +696,36 @@ int wait_for_sigchld(bool interruptible, bool return_on_trap)
  * If `timeout' is negative, the wait time is unlimited.
  * If the wait is interrupted by a signal, this function will re-wait for the
  * specified timeout, which means that this function may wait for a time length
- * longer than the specified timeout. */
-enum wait_for_input_T wait_for_input(int fd, bool trap, int timeout)
+ * longer than the specified timeout.
+ * If `ppoll' is available, there is no limit on the value of file descriptors.
+ * Otherwise, `pselect' is used and file descriptors must be less than
+ * FD_SETSIZE. */
+enum wait_for_input_T wait_for_inputs(
+        const int *fds, bool *ready, size_t count, bool trap, int timeout)
 {
     sigset_t ss;
     struct timespec to;
     struct timespec *top;
 
-    assert(fd >= 0);
-    if (fd >= FD_SETSIZE) {
-        xerror(0, Ngt("too many files are opened for yash to handle"));
-        return W_ERROR;
+    assert(count > 0);
+#if HAVE_PPOLL
+    struct pollfd pollfds[count];
+    for (size_t i = 0; i < count; i++) {
+        assert(fds[i] >= 0);
+        pollfds[i] = (struct pollfd) { .fd = fds[i], .events = POLLIN, };
     }
+#else
+    int maxfd = -1;
+    for (size_t i = 0; i < count; i++) {
+        assert(fds[i] >= 0);
+        if (fds[i] >= FD_SETSIZE) {
+            xerror(0, Ngt("too many files are opened for yash to handle"));
+            return W_ERROR;
+        }
+        if (maxfd < fds[i])
+            maxfd = fds[i];
+    }
+#endif
 
     if (trap)
         sigint_received = false;
@@ -670,22 +759,40 @@ enum wait_for_input_T wait_for_input(int fd, bool trap, int timeout)
             return W_INTERRUPTED;
         }
 
+#if HAVE_PPOLL
+        int count_ready = ppoll(pollfds, count, top, &ss);
+#else
         fd_set fdset;
         FD_ZERO(&fdset);
-        FD_SET(fd, &fdset);
+        for (size_t i = 0; i < count; i++)
+            FD_SET(fds[i], &fdset);
 
-        int count = pselect(fd + 1, &fdset, NULL, NULL, top, &ss);
+        int count_ready = pselect(maxfd + 1, &fdset, NULL, NULL, top, &ss);
+#endif
 
         if (trap && sigint_received) {
             sigint_received = false;
             return W_INTERRUPTED;
         }
 
-        if (count >= 0)
-            return FD_ISSET(fd, &fdset) ? W_READY : W_TIMED_OUT;
+        if (count_ready == 0)
+            return W_TIMED_OUT;
+        if (count_ready > 0) {
+            for (size_t i = 0; i < count; i++)
+#if HAVE_PPOLL
+                ready[i] = pollfds[i].revents != 0;
+#else
+                ready[i] = FD_ISSET(fds[i], &fdset);
+#endif
+            return W_READY;
+        }
 
         if (errno != EINTR) {
+#if HAVE_PPOLL
+            xerror(errno, "ppoll");
+#else
             xerror(errno, "pselect");
+#endif
             return W_ERROR;
         }
     }
@@ -1063,6 +1170,12 @@ void set_interrupted(void)
     sigint_received = true;
 }
 
+/* Clears the `sigint_received' flag. */
+void reset_interrupted(void)
+{
+    sigint_received = false;
+}
+
 #if YASH_ENABLE_LINEEDIT
 
 #ifdef SIGWINCH
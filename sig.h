@@ -45,12 +45,21 @@ extern void stop_myself(void);
 
 extern void handle_signals(void);
 extern int wait_for_sigchld(_Bool interruptible, _Bool return_on_trap);
+#if HAVE_PIDFD_OPEN
+struct pollfd;
+extern int wait_for_pidfds(struct pollfd *pfds, size_t count,
+        _Bool interruptible, _Bool return_on_trap)
+    __attribute__((nonnull));
+#endif
 
 enum wait_for_input_T {
     W_READY, W_TIMED_OUT, W_INTERRUPTED, W_ERROR,
 };
 
 extern enum wait_for_input_T wait_for_input(int fd, _Bool trap, int timeout);
+extern enum wait_for_input_T wait_for_inputs(
+        const int *fds, _Bool *ready, size_t count, _Bool trap, int timeout)
+    __attribute__((nonnull));
 
 extern int handle_traps(void);
 extern void execute_exit_trap(void);
@@ -59,6 +68,7 @@ extern void phantomize_traps(void);
 extern _Bool is_interrupted(void);
 extern void set_laststatus_if_interrupted(void);
 extern void set_interrupted(void);
+extern void reset_interrupted(void);
 #if YASH_ENABLE_LINEEDIT
 extern void reset_sigwinch(void);
 #endif
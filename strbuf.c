@@ -20,6 +20,9 @@
 #include "strbuf.h"
 #include <assert.h>
 #include <errno.h>
+#if HAVE_NL_LANGINFO
+# include <langinfo.h>
+#endif
 #include <limits.h>
 #include <stdarg.h>
 #include <stdbool.h>
@@ -41,6 +44,31 @@ size_t wcsnrtombs(char *restrict dst, const wchar_t **restrict src, size_t nwc,
  * the return value is the argument buffer. */
 
 
+/* The character encoding of the current LC_CTYPE locale, as far as the
+ * conversion functions in this file are concerned.
+ * In the CS_ASCII and CS_UTF8 encodings, every ASCII character is represented
+ * by the single byte of the same value and there are no shift states, so runs
+ * of ASCII characters can be converted without calling the locale-dependent
+ * functions. In the CS_UTF8 encoding, wide characters are Unicode code points,
+ * so non-ASCII characters are converted by the built-in UTF-8 codec. */
+static enum charset_T { CS_OTHER, CS_ASCII, CS_UTF8, } current_charset;
+
+static size_t ascii_span(const char *s, size_t n)
+    __attribute__((nonnull,pure));
+static size_t wcs_ascii_span(const wchar_t *s, size_t n)
+    __attribute__((nonnull,pure));
+static size_t utf8_mbrtowc(
+        wchar_t *restrict pwc, const char *restrict s, size_t n)
+    __attribute__((nonnull));
+static size_t utf8_wcrtomb(char *s, wchar_t wc)
+    __attribute__((nonnull));
+static wchar_t *sb_wcsncat_fast(xstrbuf_T *restrict buf,
+        const wchar_t *restrict s, size_t n, mbstate_t *restrict ps)
+    __attribute__((nonnull));
+static char *wb_mbscat_fast(xwcsbuf_T *restrict buf, const char *restrict s)
+    __attribute__((nonnull));
+
+
 /********** Multibyte String Buffer **********/
 
 /* Initializes the specified string buffer as an empty string. */
@@ -163,7 +191,10 @@ bool sb_wccat(xstrbuf_T *restrict buf, wchar_t c, mbstate_t *restrict ps)
     size_t count;
 
     sb_ensuremax(buf, add(buf->length, MB_CUR_MAX));
-    count = wcrtomb(&buf->contents[buf->length], c, ps);
+    if (current_charset == CS_UTF8 && c != L'\0')
+        count = utf8_wcrtomb(&buf->contents[buf->length], c);
+    else
+        count = wcrtomb(&buf->contents[buf->length], c, ps);
     if (count == (size_t) -1) {
         buf->contents[buf->length] = '\0';
         return false;
@@ -188,6 +219,9 @@ bool sb_wccat(xstrbuf_T *restrict buf, wchar_t c, mbstate_t *restrict ps)
 wchar_t *sb_wcsncat(xstrbuf_T *restrict buf,
         const wchar_t *restrict s, size_t n, mbstate_t *restrict ps)
 {
+    if (current_charset != CS_OTHER)
+        return sb_wcsncat_fast(buf, s, n, ps);
+
 #if HAVE_WCSNRTOMBS
     for (;;) {
         const wchar_t *saves = s;
@@ -234,6 +268,9 @@ wchar_t *sb_wcsncat(xstrbuf_T *restrict buf,
 wchar_t *sb_wcscat(xstrbuf_T *restrict buf,
         const wchar_t *restrict s, mbstate_t *restrict ps)
 {
+    if (current_charset != CS_OTHER)
+        return sb_wcsncat_fast(buf, s, (size_t) -1, ps);
+
     for (;;) {
         size_t count = wcsrtombs(&buf->contents[buf->length],
                 (const wchar_t **) &s,
@@ -420,6 +457,9 @@ char *wb_mbscat(xwcsbuf_T *restrict buf, const char *restrict s)
     mbstate_t state;
     size_t count;
 
+    if (current_charset != CS_OTHER)
+        return wb_mbscat_fast(buf, s);
+
     memset(&state, 0, sizeof state);  // initialize as the initial shift state
 
     for (;;) {
@@ -499,6 +539,225 @@ int wb_wprintf(xwcsbuf_T *restrict buf, const wchar_t *restrict format, ...)
 
 /********** Multibyte-Wide Conversion Utilities **********/
 
+/* Updates the character encoding information used by the conversion functions
+ * in this file. Must be called whenever the LC_CTYPE locale is changed. */
+void update_conversion_charset(void)
+{
+    current_charset = CS_OTHER;
+
+#if HAVE_NL_LANGINFO
+    const char *codeset = nl_langinfo(CODESET);
+    if (codeset == NULL)
+        return;
+
+    if (strcmp(codeset, "ANSI_X3.4-1968") == 0
+            || strcmp(codeset, "US-ASCII") == 0
+            || strcmp(codeset, "ASCII") == 0) {
+        current_charset = CS_ASCII;
+    } else if (strcmp(codeset, "UTF-8") == 0 || strcmp(codeset, "utf8") == 0) {
+        /* We use the built-in codec only if the C library agrees with it on
+         * a non-ASCII character. Otherwise, only the ASCII fast path is used.*/
+        wchar_t wc;
+        mbstate_t state;
+        memset(&state, 0, sizeof state);
+        if (mbrtowc(&wc, "\xE2\x82\xAC", 3, &state) == 3 && wc == 0x20AC)
+            current_charset = CS_UTF8;
+        else
+            current_charset = CS_ASCII;
+    }
+#endif
+}
+
+/* Returns the length of the longest prefix of the first `n' bytes of `s' that
+ * consists only of ASCII characters. A null byte counts as an ASCII character.
+ * The main loop examines a fixed-size block at a time so that it can be
+ * vectorized by the compiler. */
+size_t ascii_span(const char *s, size_t n)
+{
+    const unsigned char *us = (const unsigned char *) s;
+    size_t i = 0;
+
+    for (; n - i >= 16; i += 16) {
+        unsigned char bits = 0;
+        for (size_t j = 0; j < 16; j++)
+            bits |= us[i + j];
+        if (bits & 0x80)
+            break;
+    }
+    while (i < n && us[i] < 0x80)
+        i++;
+    return i;
+}
+
+/* Returns the length of the longest prefix of the first `n' characters of `s'
+ * that consists only of ASCII characters. A null character counts as an ASCII
+ * character. */
+size_t wcs_ascii_span(const wchar_t *s, size_t n)
+{
+    size_t i = 0;
+
+    for (; n - i >= 8; i += 8) {
+        bool nonascii = false;
+        for (size_t j = 0; j < 8; j++)
+            nonascii |= (unsigned long) s[i + j] >= 0x80;
+        if (nonascii)
+            break;
+    }
+    while (i < n && (unsigned long) s[i] < 0x80)
+        i++;
+    return i;
+}
+
+/* Converts the UTF-8 character at the beginning of `s' into a wide character.
+ * At most `n' bytes are examined. `s' must not start with a null byte.
+ * Returns the number of bytes of the converted character. If the bytes are not
+ * a valid UTF-8 sequence (as defined in RFC 3629), returns (size_t) -1 without
+ * setting `errno'. */
+size_t utf8_mbrtowc(wchar_t *restrict pwc, const char *restrict s, size_t n)
+{
+    const unsigned char *us = (const unsigned char *) s;
+    unsigned long c = us[0], min;
+    size_t len;
+
+    if (c < 0x80) {
+        *pwc = (wchar_t) c;
+        return 1;
+    } else if (c < 0xC2) {
+        return (size_t) -1;  // continuation byte or overlong sequence
+    } else if (c < 0xE0) {
+        len = 2, c &= 0x1F, min = 0x80;
+    } else if (c < 0xF0) {
+        len = 3, c &= 0x0F, min = 0x800;
+    } else if (c < 0xF5) {
+        len = 4, c &= 0x07, min = 0x10000;
+    } else {
+        return (size_t) -1;
+    }
+    if (n < len)
+        return (size_t) -1;
+    for (size_t i = 1; i < len; i++) {
+        if ((us[i] & 0xC0) != 0x80)
+            return (size_t) -1;
+        c = (c << 6) | (us[i] & 0x3F);
+    }
+    if (c < min || c > 0x10FFFF || (0xD800 <= c && c <= 0xDFFF))
+        return (size_t) -1;
+    *pwc = (wchar_t) c;
+    return len;
+}
+
+/* Converts wide character `wc' into UTF-8 and stores it in `s', which must
+ * have at least 4 bytes of room. `wc' must not be a null character.
+ * Returns the number of bytes stored. If `wc' is not a valid Unicode scalar
+ * value, returns (size_t) -1 without setting `errno'. */
+size_t utf8_wcrtomb(char *s, wchar_t wc)
+{
+    unsigned long c = (unsigned long) wc;
+
+    if (c < 0x80) {
+        s[0] = (char) c;
+        return 1;
+    } else if (c < 0x800) {
+        s[0] = (char) (0xC0 | (c >> 6));
+        s[1] = (char) (0x80 | (c & 0x3F));
+        return 2;
+    } else if (c < 0x10000) {
+        if (0xD800 <= c && c <= 0xDFFF)
+            return (size_t) -1;
+        s[0] = (char) (0xE0 | (c >> 12));
+        s[1] = (char) (0x80 | ((c >> 6) & 0x3F));
+        s[2] = (char) (0x80 | (c & 0x3F));
+        return 3;
+    } else if (c <= 0x10FFFF) {
+        s[0] = (char) (0xF0 | (c >> 18));
+        s[1] = (char) (0x80 | ((c >> 12) & 0x3F));
+        s[2] = (char) (0x80 | ((c >> 6) & 0x3F));
+        s[3] = (char) (0x80 | (c & 0x3F));
+        return 4;
+    } else {
+        return (size_t) -1;
+    }
+}
+
+/* Like `sb_wcsncat', but for the CS_ASCII and CS_UTF8 encodings only.
+ * Runs of ASCII characters are copied directly and other characters are
+ * converted one by one. */
+wchar_t *sb_wcsncat_fast(xstrbuf_T *restrict buf,
+        const wchar_t *restrict s, size_t n, mbstate_t *restrict ps)
+{
+    assert(current_charset != CS_OTHER);
+
+    const wchar_t *end = s + xwcsnlen(s, n);
+    while (s < end) {
+        size_t rest = end - s;
+        size_t count = wcs_ascii_span(s, rest);
+        if (count > 0) {
+            sb_ensuremax(buf, add(buf->length, rest));
+            char *d = &buf->contents[buf->length];
+            for (size_t i = 0; i < count; i++)
+                d[i] = (char) s[i];
+            buf->length += count;
+            s += count;
+            continue;
+        }
+
+        sb_ensuremax(buf, add(buf->length, add(rest, MB_CUR_MAX)));
+        if (current_charset == CS_UTF8)
+            count = utf8_wcrtomb(&buf->contents[buf->length], *s);
+        else
+            count = wcrtomb(&buf->contents[buf->length], *s, ps);
+        if (count == (size_t) -1) {
+            buf->contents[buf->length] = '\0';
+            return (wchar_t *) s;
+        }
+        buf->length += count;
+        s++;
+    }
+    buf->contents[buf->length] = '\0';
+    return NULL;
+}
+
+/* Like `wb_mbscat', but for the CS_ASCII and CS_UTF8 encodings only.
+ * Runs of ASCII characters are copied directly and other characters are
+ * converted one by one. */
+char *wb_mbscat_fast(xwcsbuf_T *restrict buf, const char *restrict s)
+{
+    assert(current_charset != CS_OTHER);
+
+    mbstate_t state;
+    memset(&state, 0, sizeof state);  // initialize as the initial shift state
+
+    /* A multibyte string never has more characters than bytes. */
+    const char *end = s + strlen(s);
+    wb_ensuremax(buf, add(buf->length, end - s));
+
+    wchar_t *d = &buf->contents[buf->length];
+    while (s < end) {
+        size_t rest = end - s;
+        size_t count = ascii_span(s, rest);
+        for (size_t i = 0; i < count; i++)
+            d[i] = (wchar_t) (unsigned char) s[i];
+        d += count;
+        s += count;
+        if (count == rest)
+            break;
+
+        if (current_charset == CS_UTF8)
+            count = utf8_mbrtowc(d, s, end - s);
+        else
+            count = mbrtowc(d, s, end - s, &state);
+        if (count == 0 || count > (size_t) (end - s))
+            break;
+        d++;
+        s += count;
+    }
+
+    buf->length = d - buf->contents;
+    buf->contents[buf->length] = L'\0';
+    return (s < end) ? (char *) s : NULL;
+}
+
+
 /* Converts the specified wide string into a newly malloced multibyte string.
  * Only the first `n' characters of `s' is converted at most.
  * Returns NULL on error.
@@ -176,6 +176,7 @@ extern int wb_wprintf(
         xwcsbuf_T *restrict buf, const wchar_t *restrict format, ...)
     __attribute__((nonnull(1,2)));
 
+extern void update_conversion_charset(void);
 extern char *malloc_wcsntombs(const wchar_t *s, size_t n)
     __attribute__((nonnull,malloc,warn_unused_result));
 #if HAVE_WCSNRTOMBS
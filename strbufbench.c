@@ -0,0 +1,95 @@
+// This is a benchmark tool, not part of yash
+//   make strbuf.o util.o
+//   c99 -o strbufbench strbufbench.c strbuf.o util.o
+//   ./strbufbench [iterations]
+// Each conversion function is timed twice: first with the locale-generic
+// conversion and then with the fast path selected by
+// `update_conversion_charset'. Run in a UTF-8 locale to exercise the built-in
+// UTF-8 codec.
+#include "common.h"
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+#include "strbuf.h"
+
+static const char *const samples[] = {
+    "/usr/local/share/yash/completion/git-checkout",
+    "PATH=/usr/local/sbin:/usr/local/bin:/usr/sbin:/usr/bin:/sbin:/bin",
+    "r\xC3\xA9sum\xC3\xA9-\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E.txt",
+};
+#define NSAMPLES (sizeof samples / sizeof *samples)
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void report(const char *name, const char *mode, double t, long n)
+{
+    printf("%-18s %-8s %8.1f ns/op\n", name, mode, t * 1e9 / n);
+}
+
+static void run(const char *mode, long n)
+{
+    wchar_t *wcs[NSAMPLES];
+    for (size_t i = 0; i < NSAMPLES; i++) {
+        wcs[i] = malloc_mbstowcs(samples[i]);
+        if (wcs[i] == NULL) {
+            fprintf(stderr, "cannot convert sample %zu\n", i);
+            exit(1);
+        }
+    }
+
+    double t = now();
+    for (long i = 0; i < n; i++)
+        free(malloc_mbstowcs(samples[i % NSAMPLES]));
+    report("malloc_mbstowcs", mode, now() - t, n);
+
+    t = now();
+    for (long i = 0; i < n; i++)
+        free(malloc_wcstombs(wcs[i % NSAMPLES]));
+    report("malloc_wcstombs", mode, now() - t, n);
+
+    xwcsbuf_T wbuf;
+    wb_init(&wbuf);
+    t = now();
+    for (long i = 0; i < n; i++) {
+        wb_clear(&wbuf);
+        wb_mbscat(&wbuf, samples[i % NSAMPLES]);
+    }
+    report("wb_mbscat", mode, now() - t, n);
+    wb_destroy(&wbuf);
+
+    xstrbuf_T sbuf;
+    mbstate_t state;
+    memset(&state, 0, sizeof state);
+    sb_init(&sbuf);
+    t = now();
+    for (long i = 0; i < n; i++) {
+        sb_clear(&sbuf);
+        sb_wcscat(&sbuf, wcs[i % NSAMPLES], &state);
+    }
+    report("sb_wcscat", mode, now() - t, n);
+    sb_destroy(&sbuf);
+
+    for (size_t i = 0; i < NSAMPLES; i++)
+        free(wcs[i]);
+}
+
+int main(int argc, char **argv)
+{
+    long n = argc > 1 ? atol(argv[1]) : 1000000;
+
+    setlocale(LC_ALL, "");
+    run("generic", n);
+    update_conversion_charset();
+    run("fast", n);
+    return 0;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et tw=80: */
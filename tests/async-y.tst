@@ -21,4 +21,34 @@ syntax error: `;' or `&' is missing
 __ERR__
 #'`#`
 
+test_oE -e 0 'foreground commands while asynchronous commands are running'
+sleep 1 & (exit 3) & exit 4 &
+sh -c 'exit 5'
+echo $?
+false | sh -c 'exit 6'
+echo $?
+wait %'(exit 3)'
+echo $?
+wait
+__IN__
+5
+6
+3
+__OUT__
+
+test_oE -e 0 'asynchronous commands finishing during foreground command'
+i=0
+while [ "$i" -lt 20 ]; do
+    exit "$i" &
+    i=$((i + 1))
+done
+sleep 0
+echo $?
+wait $!
+echo $?
+__IN__
+0
+19
+__OUT__
+
 # vim: set ft=sh ts=8 sts=4 sw=4 et:
@@ -0,0 +1,128 @@
+/* benchrun.c: invokes command and reports its resource usage */
+/* (C) 2026 magicant */
+
+/* This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+/* Usage: benchrun [-o file] [-r run] [-s syscalls] name command [argument...]
+ * The command is executed and, after it has exited, one line of JSON is
+ * appended to the file specified by the -o option or printed to the standard
+ * output. The line contains the wall-clock time, the user and
+ * system CPU time, and the peak resident set size (in kilobytes) consumed by
+ * the command and its waited-for descendants, as well as some other counters
+ * from `getrusage'. The operand of the -s option, if any, is included as the
+ * number of system calls. The exit status of benchrun is that of the command
+ * or 126 if the command could not be executed. */
+
+#define _POSIX_C_SOURCE 200112L
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+static double tv2sec(struct timeval tv)
+{
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) < 0) {
+        perror("benchrun: clock_gettime");
+        exit(126);
+    }
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char **argv)
+{
+    const char *output = NULL, *run = "1", *syscalls = "null";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "+o:r:s:")) != -1) {
+        switch (opt) {
+            case 'o':  output = optarg;    break;
+            case 'r':  run = optarg;       break;
+            case 's':  syscalls = optarg;  break;
+            default:   return 2;
+        }
+    }
+    if (argc - optind < 2) {
+        fprintf(stderr, "benchrun: too few arguments\n");
+        return 2;
+    }
+    const char *name = argv[optind++];
+
+    FILE *report = stdout;
+    if (output != NULL) {
+        report = fopen(output, "a");
+        if (report == NULL) {
+            perror("benchrun: cannot open output file");
+            return 126;
+        }
+    }
+
+    struct rusage before, after;
+    getrusage(RUSAGE_CHILDREN, &before);
+    double start = now();
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("benchrun: fork failed");
+        return 126;
+    } else if (pid == 0) {
+        execvp(argv[optind], &argv[optind]);
+        perror("benchrun: exec failed");
+        _exit(126);
+    }
+
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+        ;
+    double end = now();
+    getrusage(RUSAGE_CHILDREN, &after);
+
+    int exitstatus = WIFEXITED(status) ? WEXITSTATUS(status)
+                   : WIFSIGNALED(status) ? WTERMSIG(status) + 384 : 126;
+
+    fprintf(report, "{\"name\":\"%s\",\"run\":%s,\"status\":%d,"
+            "\"wall\":%.6f,\"user\":%.6f,\"sys\":%.6f,"
+            "\"maxrss\":%ld,\"minflt\":%ld,\"majflt\":%ld,"
+            "\"inblock\":%ld,\"oublock\":%ld,\"nvcsw\":%ld,\"nivcsw\":%ld,"
+            "\"syscalls\":%s}\n",
+            name, run, exitstatus,
+            end - start,
+            tv2sec(after.ru_utime) - tv2sec(before.ru_utime),
+            tv2sec(after.ru_stime) - tv2sec(before.ru_stime),
+            after.ru_maxrss,
+            after.ru_minflt - before.ru_minflt,
+            after.ru_majflt - before.ru_majflt,
+            after.ru_inblock - before.ru_inblock,
+            after.ru_oublock - before.ru_oublock,
+            after.ru_nvcsw - before.ru_nvcsw,
+            after.ru_nivcsw - before.ru_nivcsw,
+            syscalls);
+    if (fclose(report) != 0) {
+        perror("benchrun: cannot write output file");
+        return 126;
+    }
+    return exitstatus > 255 ? 126 : exitstatus;
+}
+
+/* vim: set ts=8 sts=4 sw=4 et tw=80: */
@@ -317,6 +317,20 @@ do
 done
 __OUT__
 
+test_single 'parallel for command, single line'
+for -P 2 -k i in 1 2; do cat fifo; done
+__IN__
+for -P 2 -k i in 1 2; do cat fifo; done
+__OUT__
+
+test_multi 'parallel for command, multi-line'
+for -P "$n" i; do echo $i; done
+__IN__
+for -P "${n}" i do
+   echo ${i}
+done
+__OUT__
+
 test_single 'for command, w/ commands, single line'
 for i do done && cat fifo
 __IN__
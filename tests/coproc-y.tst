@@ -0,0 +1,110 @@
+# coproc-y.tst: yash-specific test of the coproc built-in
+
+test_oE -e 0 'requests and replies through external command coprocess'
+coproc cat
+for i in 1 2 3; do
+    echo "request $i" >&"${COPROC[2]}"
+    read -r reply <&"${COPROC[1]}"
+    echo "$reply"
+done
+__IN__
+request 1
+request 2
+request 3
+__OUT__
+
+test_oE -e 0 'function as coprocess'
+f() {
+    while read -r line; do
+        printf '%s\n' "<$line>"
+    done
+}
+coproc f
+printf '%s\n' a b >&"${COPROC[2]}"
+read -r x <&"${COPROC[1]}"
+read -r y <&"${COPROC[1]}"
+echo "$x" "$y"
+__IN__
+<a> <b>
+__OUT__
+
+test_oE -e 0 'closing input ends coprocess'
+coproc cat
+echo foo >&"${COPROC[2]}"
+eval "exec ${COPROC[2]}>&-"
+cat <&"${COPROC[1]}"
+wait $!
+echo $?
+__IN__
+foo
+0
+__OUT__
+
+test_oE -e 0 'exit status of coprocess'
+coproc sh -c 'exit 3'
+wait $!
+echo $?
+__IN__
+3
+__OUT__
+
+test_oE -e 0 'file descriptors are assigned to specified variable'
+coproc -n X cat
+coproc --name=Y cat
+[ "${X[#]}" -eq 2 ] && echo X
+[ "${Y[#]}" -eq 2 ] && echo Y
+[ "${X[1]}" -ge 10 ] && [ "${X[2]}" -ge 10 ] && echo fds
+eval "exec ${X[2]}>&- ${Y[2]}>&-"
+wait
+__IN__
+X
+Y
+fds
+__OUT__
+
+test_oE -e 0 'coprocess does not hold pipes of other coprocesses'
+coproc -n C cat
+f() { cat; }
+coproc -n F f
+eval "exec ${C[2]}>&-"
+wait %cat
+echo cat $?
+eval "exec ${F[2]}>&-"
+wait
+__IN__
+cat 0
+__OUT__
+
+test_oE -e 0 'coprocess is a job'
+coproc cat
+jobs
+eval "exec ${COPROC[2]}>&-"
+wait
+__IN__
+[1] + Running              cat
+__OUT__
+
+test_oE -e 0 'file descriptors are not inherited by external commands'
+coproc cat
+sh -c 'if (echo x >&"$1") 2>/dev/null; then echo open; else echo closed; fi' \
+    sh "${COPROC[2]}"
+eval "exec ${COPROC[2]}>&-"
+wait
+__IN__
+closed
+__OUT__
+
+test_Oe -e 2 'missing operand'
+coproc
+__IN__
+coproc: this command requires an operand
+__ERR__
+
+test_Oe -e 2 'invalid variable name'
+coproc -n 1 cat
+__IN__
+coproc: `1' is not a valid variable name
+__ERR__
+#`
+
+# vim: set ft=sh ts=8 sts=4 sw=4 et:
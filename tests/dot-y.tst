@@ -100,6 +100,28 @@ __IN__
 bar
 __OUT__
 
+mkdir testpath/bundled
+printf '# yash script bundle\n9 baz\n9 qux\n13 quux\n\n%s\n%s\n%s\n' \
+    'echo baz' 'echo qux' 'echo quux $1' >testpath/bundled.bundle
+echo 'echo old baz' >testpath/bundled/baz
+echo 'echo new qux' >testpath/bundled/qux
+touch -t 200001010000 testpath/bundled/baz
+touch -t 201001010000 testpath/bundled.bundle
+
+test_oE 'dot script in bundle in $LOADPATH'
+. -L bundled/quux 1
+. -L bundled/baz
+__IN__
+quux 1
+baz
+__OUT__
+
+test_oE 'dot script newer than bundle in $LOADPATH'
+. -L bundled/qux
+__IN__
+new qux
+__OUT__
+
 )
 
 mkdir testpath/dir1 testpath/dir2
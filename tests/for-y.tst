@@ -346,4 +346,127 @@ for v in 1; do
 done
 __IN__
 
+mkfifo fifo
+
+test_oE 'parallel for loop runs all iterations'
+for -P 2 i in 3 1 2; do echo $i; done | sort
+__IN__
+1
+2
+3
+__OUT__
+
+test_oE 'parallel for loop with -k keeps order of output'
+for -P 3 -k i in 1 2 3; do
+    if [ $i -eq 1 ]; then cat fifo; fi
+    echo $i
+    if [ $i -eq 3 ]; then >fifo; fi
+done
+__IN__
+1
+2
+3
+__OUT__
+
+test_oE 'number of parallel jobs is expanded'
+n=1
+for -P "$n" -k i in 1 2; do echo $i; done
+__IN__
+1
+2
+__OUT__
+
+test_oE 'parallel for loop w/o in'
+set a b
+for -P 2 -k i do echo $i; done
+__IN__
+a
+b
+__OUT__
+
+test_oE 'variable assignment in parallel for loop does not affect shell'
+i=x
+for -P 1 i in 1; do v=1; done
+echo $i ${v-unset}
+__IN__
+x unset
+__OUT__
+
+test_oE 'exit status of parallel for loop is that of first failure'
+for -P 3 i in 0 3 4; do exit $i; done
+echo $?
+for -P 3 i in 0 0; do exit $i; done
+echo $?
+__IN__
+3
+0
+__OUT__
+
+test_oE 'break in parallel for loop stops starting iterations'
+for -P 1 -k i in 1 2 3; do echo $i; if [ $i -eq 2 ]; then break; fi; done
+__IN__
+1
+2
+__OUT__
+
+test_oE 'break in parallel for loop with redirected low file descriptors'
+for -P 1 i in 1 2 3 4 5; do
+    exec 3>/dev/null 4>/dev/null
+    if [ $i = 2 ]; then break; fi
+    echo $i
+done
+__IN__
+1
+__OUT__
+
+test_oE 'parallel for loop with -k under a low limit on open files'
+ulimit -n 64
+words= i=1
+while [ $i -le 200 ]; do
+    words="$words $i"
+    echo $i
+    i=$((i+1))
+done >expected
+for -P 2 -k i in $words; do
+    if [ $i = 1 ]; then sleep 1; fi
+    echo $i
+done >out
+diff expected out && echo ok
+__IN__
+ok
+__OUT__
+
+test_O -d -e 2 'invalid number of parallel jobs'
+for -P 0 i in 1; do echo not reached; done
+__IN__
+
+test_Oe -e 2 'keep-order option without number of jobs'
+for -k i in 1; do echo not reached; done
+__IN__
+syntax error: the -k option must be used with the -P option
+__ERR__
+
+test_Oe -e 2 'parallel for loop is not recognized (-o POSIX)' --posix
+for -P 1 i in 1; do echo not reached; done
+__IN__
+syntax error: `-P' is not a valid identifier
+syntax error: `do' is missing
+syntax error: encountered `do' without a matching `for', `while', or `until'
+syntax error: (maybe you missed `done'?)
+__ERR__
+#'
+#`
+#'
+#`
+#'
+#`
+#'
+#`
+#'
+#`
+#'
+#`
+#'
+#`
+
 # vim: set ft=sh ts=8 sts=4 sw=4 et:
@@ -262,6 +262,22 @@ Try `man yash' for details.
 __OUT__
 #`
 
+test_oE -e 0 'help of coproc'
+help coproc
+__IN__
+coproc: start a coprocess
+
+Syntax:
+	coproc [-n name] command [argument...]
+
+Options:
+	-n ...   --name=...
+	         --help
+
+Try `man yash' for details.
+__OUT__
+#`
+
 (
 if ! testee -c 'command -bv dirs' >/dev/null; then
     skip="true"
@@ -555,7 +571,7 @@ __IN__
 jobs: print info about jobs
 
 Syntax:
-	jobs [-lnprs] [job...]
+	jobs [-lnprsu] [job...]
 
 Options:
 	-l       --verbose
@@ -563,6 +579,7 @@ Options:
 	-p       --pgid-only
 	-r       --running-only
 	-s       --stopped-only
+	-u       --resource-usage
 	         --help
 
 Try `man yash' for details.
@@ -645,6 +662,23 @@ __OUT__
 
 )
 
+test_oE -e 0 'help of profile'
+help profile
+__IN__
+profile: print or write profiling statistics
+
+Syntax:
+	profile [-c] [-w file]
+
+Options:
+	-c       --clear
+	-w ...   --write=...
+	         --help
+
+Try `man yash' for details.
+__OUT__
+#`
+
 (
 if ! testee -c 'command -bv pushd' >/dev/null; then
     skip="true"
@@ -792,6 +826,7 @@ Options:
 	         -o levisiblebell
 	         -o log
 	-l       -o login
+	         -o logrusage
 	         -o markdirs
 	-m       -o monitor
 	-b       -o notify
@@ -799,6 +834,7 @@ Options:
 	         -o nullglob
 	         -o pipefail
 	         -o posixlycorrect
+	         -o profiling
 	-s       -o stdin
 	         -o traceall
 	+u       -o unset
@@ -1060,9 +1096,12 @@ wait: wait for jobs to terminate
 
 Syntax:
 	wait [job or process_id...]
+	wait -n [-p variable] [job or process_id...]
 
 Options:
-	--help
+	-n       --next
+	-p ...   --pid-variable=...
+	         --help
 
 Try `man yash' for details.
 __OUT__
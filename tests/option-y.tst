@@ -97,6 +97,71 @@ X+ echo 1
 X+ echo 2
 __ERR__
 
+test_oe 'xtrace on: YASH_XTRACEFD' -x
+exec 3>trace
+YASH_XTRACEFD=3
+echo 1
+f() { echo 2; }
+f
+(echo 3)
+unset YASH_XTRACEFD
+exec 3>&-
+sed 's/^[0-9]*\.[0-9]* [0-9]*\.[0-9]* //' trace
+__IN__
+1
+2
+3
++ YASH_XTRACEFD=3
++ echo 1
++ f
++ echo 2
++ echo 3
++ unset YASH_XTRACEFD
+__OUT__
++ exec
++ exec
++ sed 's/^[0-9]*\.[0-9]* [0-9]*\.[0-9]* //' trace
+__ERR__
+
+test_oE 'xtrace on: YASH_XTRACEFD and PS4 with expansion' -x
+exec 3>trace 2>/dev/null
+PS4='$x+ ' YASH_XTRACEFD=3
+x=1
+x=2
+echo
+PS4='- '
+YASH_XTRACEFD=
+cut -d ' ' -f 3- trace
+__IN__
+
++ PS4='$x+ ' YASH_XTRACEFD=3
+1+ x=1
+2+ x=2
+2+ echo
+- PS4='- '
+__OUT__
+
+test_oE 'xtrace on: YASH_XTRACEFD redirected for a command'
+exec 3>trace1
+YASH_XTRACEFD=3
+set -x
+echo 1 >/dev/null
+{ echo 2 >/dev/null; } 3>trace2
+echo 3 >/dev/null
+set +x
+YASH_XTRACEFD=
+exec 3>&-
+cut -d ' ' -f 3- trace1
+echo -
+cut -d ' ' -f 3- trace2
+__IN__
++ echo 1
++ echo 3
++ set '+x'
+-
++ echo 2
+__OUT__
+
 test_x -e 0 'abbreviation of -o argument' -o allex
 echo $- | grep -q a
 __IN__
@@ -0,0 +1,118 @@
+# profile-y.tst: yash-specific test of the profile built-in and the profiling
+# option
+
+test_oE -e 0 'function calls and forks are counted'
+set -o profiling
+f() { g; g; }
+g() { (:); }
+f
+f
+profile | awk '$1 == "f" || $1 == "g" { print $1, $2, $7, $8 }' | sort
+__IN__
+f 2 4 0
+g 4 4 4
+__OUT__
+
+test_oE -e 0 'and-or lists are labeled with function names and line numbers'
+set -o profiling
+f() {
+    echo 1 && echo 2
+    echo 3; echo 4
+}
+f >/dev/null
+profile | awk 'NR > 1 && $1 ~ /:/ { print $1, $2 }' | sort
+__IN__
+f:3 1
+f:4 2
+main:2 1
+main:6 1
+__OUT__
+
+test_oE -e 0 'folded stacks are written to standard output'
+set -o profiling
+f() { g; }
+g() { :; }
+f
+profile -w - | cut -d ' ' -f 1 | sort
+__IN__
+main:2
+main:3
+main:4
+main:4;f:2
+main:4;f:2;g:3
+__OUT__
+
+test_oE -e 0 'folded stacks are written to file'
+set -o profiling
+true
+profile --write=profile.out
+cut -d ' ' -f 1 profile.out
+__IN__
+main:2
+__OUT__
+
+test_oE -e 0 'statistics are cleared'
+set -o profiling
+f() { :; }
+f
+profile -c
+f
+profile | awk '$1 == "f" { print $1, $2 }'
+profile -w - | cut -d ' ' -f 1 | sort
+__IN__
+f 1
+main:4
+main:5
+main:5;f:2
+main:6
+__OUT__
+
+test_oE -e 0 'nothing is measured without profiling option'
+f() { :; }
+f
+profile
+__IN__
+FUNCTION        calls    total(ms)     self(ms)      cpu(ms)  selfcpu(ms)    forks selfforks
+
+LINE            calls    total(ms)     self(ms)      cpu(ms)  selfcpu(ms)    forks selfforks
+__OUT__
+
+test_Oe -e 2 'invalid operand'
+profile foo
+__IN__
+profile: no operand is expected
+__ERR__
+
+test_O -d -e n 'unwritable file'
+profile -w /
+__IN__
+
+test_oE -e 0 'profile is an extension built-in'
+command -V profile
+__IN__
+profile: an extension built-in
+__OUT__
+
+test_oE -e 0 'profile built-in is unavailable in POSIX mode: w/ external' \
+    --posix
+mkdir cmdtmp
+cd cmdtmp
+echo echo external script executed > profile
+chmod a+x profile
+PATH=$PWD:$PATH
+profile --help
+__IN__
+external script executed
+__OUT__
+
+test_Oe -e 127 'profile built-in is unavailable in POSIX mode: w/o external' \
+    --posix
+PATH=
+eval 'profile --help'
+__IN__
+eval: no such command `profile'
+__ERR__
+#'
+#`
+
+# vim: set ft=sh ts=8 sts=4 sw=4 et:
@@ -192,6 +192,59 @@ __IN__
 [A] [B:C:D]
 __OUT__
 
+test_oE 'reading here-string'
+read a b <<< 'foo bar  baz'
+echo "[$a]" "[$b]"
+read a <<< ''
+echo "[$a]"
+__IN__
+[foo] [bar  baz]
+[]
+__OUT__
+
+test_oE 'reading here-document with line continuation'
+read a b <<END
+foo\
+bar baz
+END
+echo "[$a]" "[$b]"
+__IN__
+[foobar] [baz]
+__OUT__
+
+test_oE 'here-string does not affect following reads from standard input'
+{
+    read a <<< 'here-string'
+    read b
+    echo "[$a]" "[$b]"
+} <<END
+stdin
+END
+__IN__
+[here-string] [stdin]
+__OUT__
+
+test_oE 'here-string followed by another redirection of standard input'
+echo file >file
+read a <<< 'here-string' <file
+echo "[$a]"
+read a <file <<< 'here-string'
+echo "[$a]"
+__IN__
+[file]
+[here-string]
+__OUT__
+
+test_oE 'here-string duplicated to another file descriptor'
+read a <<< 'here-string' 3<&0
+echo "[$a]"
+{ read a <&3; } <<< 'here-string' 3<&0
+echo "[$a]"
+__IN__
+[here-string]
+[here-string]
+__OUT__
+
 test_O -d -e 1 'reading from closed stream'
 read foo <&-
 __IN__
@@ -89,6 +89,25 @@ test_OE -e 0 'output duplication of unreadable file descriptor'
 3</dev/null >&3
 __IN__
 
+(
+openmax="$(ulimit -n 2>/dev/null)"
+if [ "$openmax" != unlimited ] && [ "${openmax:-0}" -le 2000 ]; then
+    skip="true"
+fi
+
+test_oE -e 0 'redirection to file descriptor with large number'
+exec 2000>fd2000
+echo foo >&2000
+(echo bar >&2000)
+exec 2000>&-
+cat fd2000
+__IN__
+foo
+bar
+__OUT__
+
+)
+
 test_oE -e 0 'tilde expansion not performed in here-document operand'
 HOME=/home
 cat <<~
@@ -575,4 +594,85 @@ test_OE -e 0 'keyword after redirection in compound command (non-POSIX)'
 { ( echo not printed  ) >/dev/null }
 __IN__
 
+(
+if ! testee -c ': >/dev/udp/127.0.0.1/9' 2>/dev/null; then
+    skip="true"
+fi
+
+test_OE -e 0 'datagram socket redirection'
+echo foo >/dev/udp/127.0.0.1/9
+__IN__
+
+test_O -d -e 2 'refused stream socket redirection'
+YASH_CONNECT_TIMEOUT=10
+: </dev/tcp/127.0.0.1/1
+__IN__
+
+if ! command -v python3 >/dev/null; then
+    skip="true"
+fi
+
+test_oE -e 0 'stream socket redirection to local listener'
+python3 -c '
+import os, socket
+s = socket.socket()
+s.bind(("127.0.0.1", 0))
+s.listen(5)
+with open("port.tmp", "w") as f:
+    f.write(str(s.getsockname()[1]))
+os.rename("port.tmp", "port")
+for i in range(3):
+    c, a = s.accept()
+    c.sendall(b"hello %d\n" % i)
+    c.close()
+' &
+n=0
+until [ -f port ] || [ "$n" -ge 10 ]; do sleep 1; n=$((n+1)); done
+read port <port
+cat </dev/tcp/127.0.0.1/"$port"
+cat </dev/tcp/localhost/"$port"
+YASH_CONNECT_TIMEOUT=10
+cat </dev/tcp/localhost/"$port"
+wait
+__IN__
+hello 0
+hello 1
+hello 2
+__OUT__
+
+test_oE 'stream socket redirection times out'
+python3 -c '
+import os, socket, time
+s = socket.socket()
+s.bind(("127.0.0.1", 0))
+s.listen(0)
+port = s.getsockname()[1]
+# fill the backlog so that no more connections are established
+fillers = []
+for i in range(8):
+    c = socket.socket()
+    c.setblocking(False)
+    c.connect_ex(("127.0.0.1", port))
+    fillers.append(c)
+time.sleep(0.5)
+with open("timeoutport.tmp", "w") as f:
+    f.write(str(port))
+os.rename("timeoutport.tmp", "timeoutport")
+time.sleep(30)
+' &
+n=0
+until [ -f timeoutport ] || [ "$n" -ge 10 ]; do sleep 1; n=$((n+1)); done
+read port <timeoutport
+YASH_CONNECT_TIMEOUT=1
+(: </dev/tcp/127.0.0.1/"$port") 2>error
+echo $?
+kill $!
+grep -i 'timed out' error >/dev/null && echo timed out
+__IN__
+2
+timed out
+__OUT__
+
+)
+
 # vim: set ft=sh ts=8 sts=4 sw=4 et:
@@ -0,0 +1,106 @@
+# run-bench.sh: runs a set of benchmark workloads
+# (C) 2026 magicant
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 2 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+# This script expects the pathname to the testee, the shell that is to be
+# benchmarked, followed by the pathnames to one or more workload files.
+# A workload file is a shell script that is run by the testee in a fresh
+# working directory, first with the operand "setup" and then with the operand
+# "run". Only the latter is measured. Workloads scale the amount of work by the
+# value of $BENCH_SCALE, a positive integer.
+# For each run of each workload, one line of JSON is printed to the standard
+# output (see benchrun.c for the fields).
+# If the -r option is specified, each workload is run the specified number of
+# times. The -s option specifies $BENCH_SCALE. If strace is available, each
+# workload is run once more under strace to count system calls; the -S option
+# disables that.
+
+set -Ceu
+umask u+rwx
+
+# $1 = pathname
+absolute()
+case "$1" in
+    (/*)
+        printf '%s\n' "$1";;
+    (*)
+        printf '%s/%s' "${PWD%/}" "$1";;
+esac
+
+exec </dev/null 3>&- 4>&- 5>&-
+
+cd -L .
+
+repeat=1 scale=1 count_syscalls=true
+while getopts r:s:S opt; do
+    case $opt in
+        (r)
+            repeat="$OPTARG";;
+        (s)
+            scale="$OPTARG";;
+        (S)
+            count_syscalls=false;;
+        (*)
+            exit 64 # sysexits.h EX_USAGE
+    esac
+done
+shift "$((OPTIND-1))"
+
+testee="${1:?testee not specified}"
+shift
+testee="$(absolute "$(command -v -- "$testee")")"
+benchrun="$(absolute ./benchrun)"
+
+if "$count_syscalls" && ! command -v strace >/dev/null 2>&1; then
+    count_syscalls=false
+fi
+
+export BENCH_SCALE="$scale" BENCH_SHELL="$testee"
+export LC_ALL=C
+export YASH_LOADPATH= # ignore default yashrc
+unset -v CDPATH ENV HISTFILE HISTSIZE IFS PS1 PS2 PS4 YASH_AFTER_CD
+
+work_dir="${TMPDIR:-/tmp}/yash-bench.$$"
+trap 'cd / && rm -fr "$work_dir"' EXIT
+trap 'exit 130' INT
+mkdir "$work_dir"
+
+for workload do
+    workload="$(absolute "$workload")"
+    name="${workload##*/}"
+    name="${name%.*}"
+
+    dir="$work_dir/$name"
+    mkdir "$dir"
+    (
+    cd "$dir"
+    "$testee" "$workload" setup
+
+    syscalls=null
+    if "$count_syscalls"; then
+        strace -f -c -o strace.out "$testee" "$workload" run >/dev/null
+        syscalls="$(awk '$NF == "total" { print $4 }' strace.out)"
+    fi
+
+    run=1
+    while [ "$run" -le "$repeat" ]; do
+        "$benchrun" -o result -r "$run" -s "${syscalls:-null}" "$name" \
+            "$testee" "$workload" run >/dev/null ||
+        printf '%s: workload %s failed\n' "$0" "$name" >&2
+        run=$((run + 1))
+    done
+    cat result
+    )
+done
@@ -0,0 +1,111 @@
+# rusage-y.tst: yash-specific test of resource usage accounting
+
+test_oE 'YASH_RUSAGE is not defined initially'
+echo "${YASH_RUSAGE-unset}"
+__IN__
+unset
+__OUT__
+
+test_oE 'YASH_RUSAGE is updated by foreground external command'
+sh -c 'exit 0'
+echo ${YASH_RUSAGE[#]}
+for value in "${YASH_RUSAGE[@]}"; do
+    case $value in
+        (*[!0-9.]* | '') echo "bad value: $value" ;;
+    esac
+done
+__IN__
+7
+__OUT__
+
+test_x -e 0 'YASH_RUSAGE is not updated by built-ins'
+sh -c 'exit 0'
+before="${YASH_RUSAGE[*]}"
+true
+[ "$before" = "${YASH_RUSAGE[*]}" ]
+__IN__
+
+test_x -e 0 'YASH_RUSAGE is not updated by command substitution'
+sh -c 'exit 0'
+before="${YASH_RUSAGE[*]}"
+: $(sh -c 'i=0; while [ $i -lt 1000 ]; do i=$((i+1)); done')
+[ "$before" = "${YASH_RUSAGE[*]}" ]
+__IN__
+
+test_oE 'YASH_RUSAGE is not updated by asynchronous command'
+sh -c 'exit 0' &
+wait
+echo "${YASH_RUSAGE-unset}"
+__IN__
+unset
+__OUT__
+
+test_oE 'assigning to YASH_RUSAGE'
+sh -c 'exit 0'
+YASH_RUSAGE=foo
+sh -c 'exit 0'
+echo "$YASH_RUSAGE"
+__IN__
+foo
+__OUT__
+
+test_oE 'YASH_RUSAGE defined by user is left intact'
+YASH_RUSAGE=foo
+sh -c 'exit 0'
+echo "$YASH_RUSAGE"
+__IN__
+foo
+__OUT__
+
+test_oE 'logrusage option: simple command'
+"$TESTEE" -o logrusage -c 'sh -c "exit 0"; true' 2>&1 |
+sed 's/=[0-9][0-9.]*/=N/g'
+__IN__
+rusage: user=N sys=N maxrss=N nvcsw=N nivcsw=N inblock=N oublock=N sh -c "exit 0"
+__OUT__
+
+test_oE 'logrusage option: pipeline'
+"$TESTEE" -o logrusage -c 'echo foo | cat >/dev/null; true' 2>&1 |
+sed 's/=[0-9][0-9.]*/=N/g'
+__IN__
+rusage: user=N sys=N maxrss=N nvcsw=N nivcsw=N inblock=N oublock=N echo foo
+rusage: user=N sys=N maxrss=N nvcsw=N nivcsw=N inblock=N oublock=N cat 1>/dev/null
+__OUT__
+
+test_oE 'logrusage option: function and subshell'
+"$TESTEE" -o logrusage -c 'f() { sh -c "exit 0"; true; }; f; (true); true' 2>&1 |
+sed 's/=[0-9][0-9.]*/=N/g'
+__IN__
+rusage: user=N sys=N maxrss=N nvcsw=N nivcsw=N inblock=N oublock=N sh -c "exit 0"
+rusage: user=N sys=N maxrss=N nvcsw=N nivcsw=N inblock=N oublock=N (true)
+__OUT__
+
+test_oE 'jobs -u prints resource usage of finished processes'
+sh -c 'exit 3' | cat &
+while kill -0 $! 2>/dev/null; do :; done
+jobs -u >out
+sed 's/[0-9][0-9.]*/N/g; s/  */ /g' out
+__IN__
+[N] + N Done(N) sh -c 'exit N'
+ user=N sys=N maxrss=N nvcsw=N nivcsw=N inblock=N oublock=N
+ N Done | cat
+ user=N sys=N maxrss=N nvcsw=N nivcsw=N inblock=N oublock=N
+__OUT__
+#'
+
+test_Oe -e 2 'jobs -u in POSIX mode'
+set -o posixlycorrect
+jobs -u
+__IN__
+jobs: `-u' is not a valid option
+__ERR__
+#'
+#`
+
+test_oE 'YASH_RUSAGE is not defined in POSIX mode'
+"$TESTEE" --posix -c 'echo "${YASH_RUSAGE-unset}"'
+__IN__
+unset
+__OUT__
+
+# vim: set ft=sh ts=8 sts=4 sw=4 et:
\ No newline at end of file
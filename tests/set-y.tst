@@ -201,6 +201,7 @@ test_long_option_default_off "$LINENO" extendedglob
 test_long_option_default_on  "$LINENO" glob
 test_long_option_default_off "$LINENO" hashondef
 test_long_option_default_off "$LINENO" ignoreeof
+test_long_option_default_off "$LINENO" logrusage
 test_long_option_default_off "$LINENO" markdirs
 # The monitor option cannot be tested here due to dependency on the terminal.
 test_long_option_default_off "$LINENO" notify
@@ -208,6 +209,7 @@ test_long_option_default_off "$LINENO" nullglob
 test_long_option_default_off "$LINENO" pipefail
 # This needs a special test (see below)
 #test_long_option_default_off "$LINENO" posixlycorrect
+test_long_option_default_off "$LINENO" profiling
 test_long_option_default_on  "$LINENO" traceall
 test_long_option_default_on  "$LINENO" unset
 test_long_option_default_off "$LINENO" verbose
@@ -418,12 +420,14 @@ ignoreeof       off
 interactive     off
 log             on
 login           off
+logrusage       off
 markdirs        off
 monitor         off
 notify          off
 nullglob        off
 pipefail        off
 posixlycorrect  off
+profiling       off
 stdin           on
 traceall        on
 unset           on
@@ -475,12 +479,14 @@ set -o glob
 set +o hashondef
 set +o ignoreeof
 set -o log
+set +o logrusage
 set +o markdirs
 set +o monitor
 set +o notify
 set +o nullglob
 set +o pipefail
 set +o posixlycorrect
+set +o profiling
 set -o traceall
 set -o unset
 set +o verbose
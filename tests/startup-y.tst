@@ -459,6 +459,7 @@ Options:
 	         -o levisiblebell
 	         -o log
 	-l       -o login
+	         -o logrusage
 	         -o markdirs
 	-m       -o monitor
 	-b       -o notify
@@ -466,6 +467,7 @@ Options:
 	         -o nullglob
 	         -o pipefail
 	         -o posixlycorrect
+	         -o profiling
 	-s       -o stdin
 	         -o traceall
 	+u       -o unset
@@ -518,6 +520,7 @@ Options:
 	         -o levisiblebell
 	         -o log
 	-l       -o login
+	         -o logrusage
 	         -o markdirs
 	-m       -o monitor
 	-b       -o notify
@@ -525,6 +528,7 @@ Options:
 	         -o nullglob
 	         -o pipefail
 	         -o posixlycorrect
+	         -o profiling
 	-s       -o stdin
 	         -o traceall
 	+u       -o unset
@@ -66,6 +66,73 @@ wait
 wait $pid
 __IN__
 
+test_x -e 3 'wait -n returns exit status of finished job'
+exec >sync && exit 3 &
+cat sync
+wait -n
+__IN__
+
+test_o 'wait -n waits for running job'
+cat sync >/dev/null && exit 5 &
+exit 4 &
+wait $!
+>sync
+wait -n
+echo $?
+__IN__
+5
+__OUT__
+
+test_o 'wait -n waits for specified jobs only'
+cat sync >/dev/null && exit 6 &
+pid=$!
+exit 7 &
+>sync
+wait -n $pid
+echo $?
+wait -n
+echo $?
+__IN__
+6
+7
+__OUT__
+
+test_x -e 127 'wait -n without jobs'
+wait -n
+__IN__
+
+test_o 'wait -n -p assigns process ID of finished job'
+exit 8 &
+pid=$!
+wait -n -p var
+echo $? $((var == pid))
+__IN__
+8 1
+__OUT__
+
+test_o 'wait -n -p leaves variable intact without jobs'
+var=x
+wait -n -p var
+echo $? $var
+__IN__
+127 x
+__OUT__
+
+test_Oe -e 2 'wait -p without -n'
+wait -p var
+__IN__
+wait: the -p option must be used with the -n option
+__ERR__
+
+test_o 'YASH_JOB_LIMIT delays asynchronous command'
+YASH_JOB_LIMIT=1
+echo 1 >out &
+cat out &
+wait
+__IN__
+1
+__OUT__
+
 test_Oe -e 2 'invalid option --xxx'
 wait --no-such=option
 __IN__
@@ -25,11 +25,15 @@
 # include <libintl.h>
 #endif
 #include <limits.h>
+#include <locale.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <time.h>
 #include <wchar.h>
 #include "exec.h"
 #include "option.h"
@@ -221,6 +225,119 @@ void *copyaswcs(const void *p)
     return xwcsdup(p);
 }
 
+/* Returns true if the collation order of the current locale is the order of
+ * character codes, in which case `wcscoll' is equivalent to `wcscmp'.
+ * Besides the C/POSIX locale, the C.UTF-8 locale is recognized, which collates
+ * strings by code points. Other locales are assumed to have their own order. */
+bool collation_is_codepoint_order(void)
+{
+    const char *name = setlocale(LC_COLLATE, NULL);
+    return name == NULL || strcmp(name, "C") == 0 || strcmp(name, "POSIX") == 0
+        || strcmp(name, "C.UTF-8") == 0 || strcmp(name, "C.utf8") == 0;
+}
+
+/* Returns a newly malloced collation key for the specified string, that is,
+ * the result of `wcsxfrm'. Comparing two keys with `wcscmp' yields the same
+ * result as comparing the original strings with `wcscoll'.
+ * If the string cannot be transformed, a copy of the string is returned. */
+wchar_t *malloc_wcsxfrm(const wchar_t *s)
+{
+    /* Collation keys are typically several times as long as the original
+     * string. We start with a guess and retry with the exact size if it is too
+     * small. */
+    size_t size = add(mul(wcslen(s), 4), 1);
+    wchar_t *key = xmallocn(size, sizeof *key);
+    for (;;) {
+        errno = 0;
+        size_t length = wcsxfrm(key, s, size);
+        if (errno != 0 || length == (size_t) -1) {
+            free(key);
+            return xwcsdup(s);
+        }
+        if (length < size)
+            return key;
+        size = add(length, 1);
+        key = xreallocn(key, size, sizeof *key);
+    }
+}
+
+/* An element of the array sorted in `sort_wcs_by_collation'. */
+struct collkey_T {
+    wchar_t *key;
+    void *value;
+};
+
+static int wcscmp_vp(const void *p1, const void *p2)
+    __attribute__((pure,nonnull));
+static int collkey_cmp(const void *p1, const void *p2)
+    __attribute__((pure,nonnull));
+
+/* Sorts the specified array of `count' wide strings in the collation order of
+ * the current locale.
+ * Rather than calling `wcscoll' for every comparison, a collation key is
+ * computed once for each string. */
+void sort_wcs_by_collation(void **array, size_t count)
+{
+    if (count < 2)
+        return;
+    if (collation_is_codepoint_order()) {
+        qsort(array, count, sizeof *array, wcscmp_vp);
+        return;
+    }
+
+    struct collkey_T *keys = xmallocn(count, sizeof *keys);
+    for (size_t i = 0; i < count; i++) {
+        keys[i].key = malloc_wcsxfrm(array[i]);
+        keys[i].value = array[i];
+    }
+    qsort(keys, count, sizeof *keys, collkey_cmp);
+    for (size_t i = 0; i < count; i++) {
+        array[i] = keys[i].value;
+        free(keys[i].key);
+    }
+    free(keys);
+}
+
+int wcscmp_vp(const void *p1, const void *p2)
+{
+    return wcscmp(*(const wchar_t *const *) p1, *(const wchar_t *const *) p2);
+}
+
+int collkey_cmp(const void *p1, const void *p2)
+{
+    const struct collkey_T *k1 = p1, *k2 = p2;
+    return wcscmp(k1->key, k2->key);
+}
+
+
+/********** Time Utilities **********/
+
+/* Returns the current time in seconds.
+ * The time is measured from an unspecified point in the past and is not
+ * affected by changes to the system clock if the system supports it. */
+double monotonic_time(void)
+{
+#if HAVE_CLOCK_MONOTONIC
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/* Returns the user and system CPU time consumed by the shell process so far,
+ * in seconds. */
+double process_cpu_time(void)
+{
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) < 0)
+        return 0.0;
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6
+        + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+}
+
 
 /********** Error Utilities **********/
 
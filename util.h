@@ -209,6 +209,10 @@ extern wchar_t *matchwcsprefix(const wchar_t *s, const wchar_t *prefix)
     __attribute__((pure,nonnull));
 extern void *copyaswcs(const void *p)
     __attribute__((malloc,warn_unused_result,nonnull));
+extern _Bool collation_is_codepoint_order(void);
+extern wchar_t *malloc_wcsxfrm(const wchar_t *s)
+    __attribute__((malloc,warn_unused_result,nonnull));
+extern void sort_wcs_by_collation(void **array, size_t count);
 
 #if HAVE_STRNLEN
 # ifndef strnlen
@@ -269,6 +273,12 @@ wchar_t *xwcsdup(const wchar_t *s)
     ((union { char c; unsigned char uc; }) { .uc = (unsigned char) (value), }.c)
 
 
+/********** Time Utilities **********/
+
+extern double monotonic_time(void);
+extern double process_cpu_time(void);
+
+
 /********** Error Utilities **********/
 
 extern const wchar_t *yash_program_invocation_name;
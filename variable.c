@@ -42,6 +42,7 @@
 #include "expand.h"
 #include "hashtable.h"
 #include "input.h"
+#include "job.h"
 #include "option.h"
 #include "parser.h"
 #include "path.h"
@@ -164,6 +165,8 @@ static void lineno_getter(variable_T *var)
     __attribute__((nonnull));
 static void random_getter(variable_T *var)
     __attribute__((nonnull));
+static void rusage_getter(variable_T *var)
+    __attribute__((nonnull));
 static unsigned next_random(void);
 
 static void variable_set(const wchar_t *name, variable_T *var)
@@ -192,6 +195,8 @@ static environ_T *first_env;
 
 /* whether $RANDOM is functioning as a random number */
 static bool random_active;
+/* whether we have tried to define $YASH_RUSAGE */
+static bool rusage_defined;
 
 /* hashtable from function names (wchar_t *) to functions (function_T *). */
 static hashtable_T functions;
@@ -506,6 +511,8 @@ void reset_locale_category(const wchar_t *name, int category)
     if (wlocale != NULL) {
         setlocale(category, wlocale);
         free(wlocale);
+        if (category == LC_CTYPE)
+            update_conversion_charset();
     }
 }
 
@@ -1057,6 +1064,48 @@ void random_getter(variable_T *var)
         update_environment(L VAR_RANDOM);
 }
 
+/* Defines $YASH_RUSAGE to expose `lastrusage'. This function is called each
+ * time a foreground job finishes, but the variable is defined only the first
+ * time, so that it is never redefined once the user reassigned or removed it.
+ * If the variable already exists, it is left intact. */
+void define_rusage_variable(void)
+{
+    if (rusage_defined || posixly_correct)
+        return;
+    rusage_defined = true;
+
+    if (search_variable(L VAR_YASH_RUSAGE) != NULL)
+        return;
+
+    variable_T *v = new_variable(L VAR_YASH_RUSAGE, SCOPE_GLOBAL);
+    assert(v != NULL);
+    v->v_type = VF_ARRAY;
+    v->v_vals = xmalloc(sizeof *v->v_vals);
+    v->v_vals[0] = NULL;
+    v->v_valc = 0;
+    v->v_getter = rusage_getter;
+}
+
+/* getter for $YASH_RUSAGE */
+void rusage_getter(variable_T *var)
+{
+    assert((var->v_type & VF_MASK) == VF_ARRAY);
+    const struct rusage *ru = &lastrusage;
+    plfree(var->v_vals, free);
+    var->v_valc = 7;
+    var->v_vals = xmallocn(var->v_valc + 1, sizeof *var->v_vals);
+    var->v_vals[0] = malloc_wprintf(L"%jd.%06ld",
+            (intmax_t) ru->ru_utime.tv_sec, (long) ru->ru_utime.tv_usec);
+    var->v_vals[1] = malloc_wprintf(L"%jd.%06ld",
+            (intmax_t) ru->ru_stime.tv_sec, (long) ru->ru_stime.tv_usec);
+    var->v_vals[2] = malloc_wprintf(L"%ld", (long) ru->ru_maxrss);
+    var->v_vals[3] = malloc_wprintf(L"%ld", (long) ru->ru_nvcsw);
+    var->v_vals[4] = malloc_wprintf(L"%ld", (long) ru->ru_nivcsw);
+    var->v_vals[5] = malloc_wprintf(L"%ld", (long) ru->ru_inblock);
+    var->v_vals[6] = malloc_wprintf(L"%ld", (long) ru->ru_oublock);
+    var->v_vals[7] = NULL;
+}
+
 /* Returns a random number between 0 and 32767 using `rand'. */
 unsigned next_random(void)
 {
@@ -1124,8 +1173,18 @@ void variable_set(const wchar_t *name, variable_T *var)
         break;
 #endif /* YASH_ENABLE_LINEEDIT */
     case L'Y':
-        if (wcscmp(name, L VAR_YASH_LOADPATH) == 0)
+        if (wcscmp(name, L VAR_YASH_LOADPATH) == 0) {
             reset_path(PA_LOADPATH, var);
+        } else if (wcscmp(name, L VAR_YASH_XTRACEFD) == 0) {
+            int fd;
+            if (var == NULL
+                    || (var->v_type & VF_MASK) != VF_SCALAR
+                    || var->v_value == NULL
+                    || !xwcstoi(var->v_value, 10, &fd)
+                    || fd < 0)
+                fd = -1;
+            set_xtrace_fd(fd);
+        }
         break;
     }
 }
@@ -2845,7 +2904,8 @@ bool read_with_prompt(
 {
     bool firstline = true;
     bool completed = false;
-    bool use_prompt = is_interactive_now && isatty(STDIN_FILENO);
+    bool use_prompt = is_interactive_now &&
+        stdin_input_file_info->fd >= 0 && isatty(STDIN_FILENO);
 
     while (!completed) {
         wchar_t *line;
@@ -28,6 +28,7 @@ extern char **environ;
 /* variable names */
 #define VAR_CDPATH                    "CDPATH"
 #define VAR_COLUMNS                   "COLUMNS"
+#define VAR_COPROC                    "COPROC"
 #define VAR_COMMAND                   "COMMAND"
 #define VAR_COMMAND_NOT_FOUND_HANDLER "COMMAND_NOT_FOUND_HANDLER"
 #define VAR_DIRSTACK                  "DIRSTACK"
@@ -71,9 +72,13 @@ extern char **environ;
 #define VAR_WORDS                     "WORDS"
 #define VAR_XDG_CONFIG_HOME           "XDG_CONFIG_HOME"
 #define VAR_YASH_AFTER_CD             "YASH_AFTER_CD"
+#define VAR_YASH_CONNECT_TIMEOUT      "YASH_CONNECT_TIMEOUT"
+#define VAR_YASH_JOB_LIMIT            "YASH_JOB_LIMIT"
 #define VAR_YASH_LE_TIMEOUT           "YASH_LE_TIMEOUT"
 #define VAR_YASH_LOADPATH             "YASH_LOADPATH"
+#define VAR_YASH_RUSAGE               "YASH_RUSAGE"
 #define VAR_YASH_VERSION              "YASH_VERSION"
+#define VAR_YASH_XTRACEFD             "YASH_XTRACEFD"
 #define L                             L""
 
 struct variable_T;
@@ -126,6 +131,7 @@ extern void open_new_environment(_Bool temp);
 extern void close_current_environment(void);
 
 extern void update_lineno(unsigned long lineno);
+extern void define_rusage_variable(void);
 
 extern char **decompose_paths(const wchar_t *paths)
     __attribute__((malloc,warn_unused_result));
@@ -99,6 +99,7 @@ int main(int argc, char **argv)
     setvbuf(stderr, NULL, _IOLBF, BUFSIZ);
 
     setlocale(LC_ALL, "");
+    update_conversion_charset();
 #if HAVE_GETTEXT
     bindtextdomain(PACKAGE_NAME, LOCALEDIR);
     textdomain(PACKAGE_NAME);
@@ -389,6 +390,7 @@ void exit_shell_with_status(int status)
 #if YASH_ENABLE_HISTORY
     finalize_history();
 #endif
+    flush_xtrace();
     _Exit(exitstatus);
 }
 
@@ -524,6 +526,32 @@ void exec_input(int fd, const char *name, exec_input_options_T options)
     free(inputinfo);
 }
 
+/* Parses the specified wide string and executes it as commands in the same
+ * manner as `exec_input'. This function is used to execute a script file whose
+ * contents have already been read into memory. `options' must not include
+ * XIO_INTERACTIVE. */
+void exec_script_wcs(
+        const wchar_t *code, const char *name, exec_input_options_T options)
+{
+    assert(!(options & XIO_INTERACTIVE));
+
+    struct input_wcs_info_T iinfo = {
+        .src = code,
+    };
+    struct parseparam_T pinfo = {
+        .print_errmsg = true,
+        .enable_verbose = true,
+        .enable_alias = options & XIO_SUBST_ALIAS,
+        .filename = name,
+        .lineno = 1,
+        .input = input_wcs,
+        .inputinfo = &iinfo,
+        .interactive = false,
+    };
+
+    parse_and_exec(&pinfo, options & XIO_FINALLY_EXIT);
+}
+
 /* Parses the input using the specified `parseparam_T' and executes commands.
  * If no commands were executed, `laststatus' is set to Exit_SUCCESS. */
 void parse_and_exec(parseparam_T *pinfo, bool finally_exit)